@@ -0,0 +1,162 @@
+/*
+ *  AtomicDisjSets.h
+ *  MazeInC
+ *
+ *  Copyright 2009-2018 Matthew T. Pandina. All rights reserved.
+ *
+ */
+
+#ifndef ATOMICDISJSETS_H
+#define ATOMICDISJSETS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// A union-find forest that any number of threads may use at once, without locks. Each element holds the
+// index of its parent, and roots point to themselves. Finds use path splitting, and a union links one root
+// beneath the other with a single compare-and-swap, retrying if another thread got there first.
+//
+// Instead of ranks, roots are linked by a fixed pseudo-random priority (randomized linking), so the trees
+// stay shallow without any extra memory, and since priorities never change, concurrent unions can never
+// form a cycle. Every operation is lock-free, though not wait-free: a union can retry for as long as other
+// threads keep changing the same roots.
+//
+// Elements are uint32_t for up to 2^32 elements, or uint64_t using the AtomicDisjSets64 functions.
+
+typedef uint32_t *AtomicDisjSetsRef;
+typedef uint64_t *AtomicDisjSets64Ref;
+
+// Multiplying by an odd constant is a bijection, so no two elements ever share a priority
+static inline uint32_t AtomicDisjSets_priority(uint32_t x) {
+    return x * 0x9E3779B9u;
+}
+
+static inline uint64_t AtomicDisjSets64_priority(uint64_t x) {
+    return x * 0x9E3779B97F4A7C15ULL;
+}
+
+// Makes every element in [first, last) a set of its own; threads may reset disjoint ranges at once
+static inline void AtomicDisjSets_reset(AtomicDisjSetsRef djs, uint32_t first, uint32_t last) {
+    for (uint32_t i = first; i < last; ++i)
+        djs[i] = i;
+}
+
+static inline void AtomicDisjSets64_reset(AtomicDisjSets64Ref djs, uint64_t first, uint64_t last) {
+    for (uint64_t i = first; i < last; ++i)
+        djs[i] = i;
+}
+
+static inline AtomicDisjSetsRef AtomicDisjSets_create(uint32_t size) {
+    AtomicDisjSetsRef djs = (AtomicDisjSetsRef)malloc(sizeof(uint32_t) * size);
+    AtomicDisjSets_reset(djs, 0, size);
+    return djs;
+}
+
+static inline AtomicDisjSets64Ref AtomicDisjSets64_create(uint64_t size) {
+    AtomicDisjSets64Ref djs = (AtomicDisjSets64Ref)malloc(sizeof(uint64_t) * size);
+    AtomicDisjSets64_reset(djs, 0, size);
+    return djs;
+}
+
+static inline void AtomicDisjSets_delete(AtomicDisjSetsRef djs) {
+    free(djs);
+}
+
+static inline void AtomicDisjSets64_delete(AtomicDisjSets64Ref djs) {
+    free(djs);
+}
+
+static inline uint32_t AtomicDisjSets_find(AtomicDisjSetsRef djs, uint32_t x) {
+    while (true) {
+        uint32_t p = __atomic_load_n(&djs[x], __ATOMIC_ACQUIRE);
+        if (p == x)
+            return x;
+        uint32_t gp = __atomic_load_n(&djs[p], __ATOMIC_ACQUIRE);
+        if (gp != p) // path splitting; losing this race is harmless
+            __atomic_compare_exchange_n(&djs[x], &p, gp, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+        x = p;
+    }
+}
+
+static inline uint64_t AtomicDisjSets64_find(AtomicDisjSets64Ref djs, uint64_t x) {
+    while (true) {
+        uint64_t p = __atomic_load_n(&djs[x], __ATOMIC_ACQUIRE);
+        if (p == x)
+            return x;
+        uint64_t gp = __atomic_load_n(&djs[p], __ATOMIC_ACQUIRE);
+        if (gp != p) // path splitting; losing this race is harmless
+            __atomic_compare_exchange_n(&djs[x], &p, gp, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+        x = p;
+    }
+}
+
+// Unlike DisjSets_union(), x and y may be any elements, not just roots. Returns false if they were already
+// in the same set.
+static inline bool AtomicDisjSets_union(AtomicDisjSetsRef djs, uint32_t x, uint32_t y) {
+    while (true) {
+        x = AtomicDisjSets_find(djs, x);
+        y = AtomicDisjSets_find(djs, y);
+        if (x == y)
+            return false;
+        if (AtomicDisjSets_priority(x) > AtomicDisjSets_priority(y)) {
+            uint32_t tmp = x;
+            x = y;
+            y = tmp;
+        }
+        uint32_t expected = x;
+        if (__atomic_compare_exchange_n(&djs[x], &expected, y, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            return true;
+    }
+}
+
+static inline bool AtomicDisjSets64_union(AtomicDisjSets64Ref djs, uint64_t x, uint64_t y) {
+    while (true) {
+        x = AtomicDisjSets64_find(djs, x);
+        y = AtomicDisjSets64_find(djs, y);
+        if (x == y)
+            return false;
+        if (AtomicDisjSets64_priority(x) > AtomicDisjSets64_priority(y)) {
+            uint64_t tmp = x;
+            x = y;
+            y = tmp;
+        }
+        uint64_t expected = x;
+        if (__atomic_compare_exchange_n(&djs[x], &expected, y, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            return true;
+    }
+}
+
+// A root found for x may have been linked beneath another one by the time y's root is found, so the answer
+// is only final once x's root is seen to still be a root afterwards
+static inline bool AtomicDisjSets_sameSet(AtomicDisjSetsRef djs, uint32_t x, uint32_t y) {
+    while (true) {
+        x = AtomicDisjSets_find(djs, x);
+        y = AtomicDisjSets_find(djs, y);
+        if (x == y)
+            return true;
+        if (__atomic_load_n(&djs[x], __ATOMIC_ACQUIRE) == x)
+            return false;
+    }
+}
+
+static inline bool AtomicDisjSets64_sameSet(AtomicDisjSets64Ref djs, uint64_t x, uint64_t y) {
+    while (true) {
+        x = AtomicDisjSets64_find(djs, x);
+        y = AtomicDisjSets64_find(djs, y);
+        if (x == y)
+            return true;
+        if (__atomic_load_n(&djs[x], __ATOMIC_ACQUIRE) == x)
+            return false;
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ATOMICDISJSETS_H
@@ -18,22 +18,38 @@ extern "C" {
 #include <stdbool.h>
 #include <string.h>
 
+// Bits are indexed with 32-bit integers, or with 64-bit integers when MAZE_64BIT is defined (see Maze.h)
+#ifdef MAZE_64BIT
+typedef uint64_t BitArrayIndex;
+#else
+typedef uint32_t BitArrayIndex;
+#endif
+
+// Bits are stored 64 to a word, with bit index held in bit (index % 64) of word (index / 64), so scans can skip
+// over 64 bits at a time with the compiler's bit-scan and popcount intrinsics. Bits past numBits in the last word
+// must be left clear, as BitArray_reset() leaves them.
 typedef struct _BitArray {
-    uint32_t numBits;
-    uint8_t *data;
-    uint32_t data_length;
+    BitArrayIndex numBits;
+    uint64_t *data;
+    BitArrayIndex data_length; // in words
 } BitArray;
 typedef BitArray *BitArrayRef;
 
+#define BITARRAY_WORD_BITS 64
+
+static inline BitArrayIndex BitArray_wordCount(BitArrayIndex numBits) {
+    return numBits / BITARRAY_WORD_BITS + ((numBits % BITARRAY_WORD_BITS) ? 1 : 0);
+}
+
 static inline void BitArray_reset(BitArrayRef ba) {
-    memset(ba->data, 0, ba->data_length);
+    memset(ba->data, 0, sizeof(uint64_t) * ba->data_length);
 }
 
-static inline BitArrayRef BitArray_create(uint32_t numBits, bool zeroData) {
+static inline BitArrayRef BitArray_create(BitArrayIndex numBits, bool zeroData) {
     BitArrayRef ba = (BitArrayRef)malloc(sizeof(BitArray));
     ba->numBits = numBits;
-    ba->data_length = numBits / 8 + ((numBits % 8) ? 1 : 0);
-    ba->data = (uint8_t*)malloc(ba->data_length);
+    ba->data_length = BitArray_wordCount(numBits);
+    ba->data = (uint64_t*)malloc(sizeof(uint64_t) * (ba->data_length ? ba->data_length : 1));
     if (zeroData)
         BitArray_reset(ba);
     return ba;
@@ -44,16 +60,129 @@ static inline void BitArray_delete(BitArrayRef ba) {
     free(ba);
 }
 
-static inline void BitArray_setBit(BitArrayRef ba, uint32_t index) {
-    ba->data[index / 8] |= 1 << (index % 8);
+static inline void BitArray_setBit(BitArrayRef ba, BitArrayIndex index) {
+    ba->data[index / BITARRAY_WORD_BITS] |= (uint64_t)1 << (index % BITARRAY_WORD_BITS);
+}
+
+// Safe to call from multiple threads that may be setting bits within the same word
+static inline void BitArray_setBitAtomic(BitArrayRef ba, BitArrayIndex index) {
+    __atomic_fetch_or(&ba->data[index / BITARRAY_WORD_BITS], (uint64_t)1 << (index % BITARRAY_WORD_BITS), __ATOMIC_RELAXED);
+}
+
+static inline void BitArray_clearBit(BitArrayRef ba, BitArrayIndex index) {
+    ba->data[index / BITARRAY_WORD_BITS] &= ~((uint64_t)1 << (index % BITARRAY_WORD_BITS));
+}
+
+static inline bool BitArray_readBit(BitArrayRef ba, BitArrayIndex index) {
+    return (ba->data[index / BITARRAY_WORD_BITS] >> (index % BITARRAY_WORD_BITS)) & 1;
+}
+
+// Safe to call while other threads may be setting other bits within the same word
+static inline bool BitArray_readBitAtomic(BitArrayRef ba, BitArrayIndex index) {
+    return (__atomic_load_n(&ba->data[index / BITARRAY_WORD_BITS], __ATOMIC_RELAXED) >> (index % BITARRAY_WORD_BITS)) & 1;
+}
+
+// Returns count (1 to 64) bits starting at bit index, with bit index in the lowest bit
+static inline uint64_t BitArray_readBits(BitArrayRef ba, BitArrayIndex index, uint32_t count) {
+    BitArrayIndex word = index / BITARRAY_WORD_BITS;
+    uint32_t offset = index % BITARRAY_WORD_BITS;
+    uint64_t bits = ba->data[word] >> offset;
+    if (offset + count > BITARRAY_WORD_BITS)
+        bits |= ba->data[word + 1] << (BITARRAY_WORD_BITS - offset);
+    return (count < BITARRAY_WORD_BITS) ? bits & (((uint64_t)1 << count) - 1) : bits;
+}
+
+// Sets the bits that are set in the lowest count (1 to 64) bits of bits, starting at bit index
+static inline void BitArray_orBits(BitArrayRef ba, BitArrayIndex index, uint64_t bits, uint32_t count) {
+    BitArrayIndex word = index / BITARRAY_WORD_BITS;
+    uint32_t offset = index % BITARRAY_WORD_BITS;
+    ba->data[word] |= bits << offset;
+    if (offset + count > BITARRAY_WORD_BITS)
+        ba->data[word + 1] |= bits >> (BITARRAY_WORD_BITS - offset);
+}
+
+// The bits of a word from bit first up to (but not including) bit last, where 0 <= first < last <= 64
+static inline uint64_t BitArray_wordMask(uint32_t first, uint32_t last) {
+    return (~(uint64_t)0 >> (BITARRAY_WORD_BITS - (last - first))) << first;
+}
+
+// Sets (or clears) every bit in [first, last)
+static inline void BitArray_writeRange(BitArrayRef ba, BitArrayIndex first, BitArrayIndex last, bool value) {
+    while (first < last) {
+        BitArrayIndex word = first / BITARRAY_WORD_BITS;
+        uint32_t offset = first % BITARRAY_WORD_BITS;
+        uint32_t end = (last - first < BITARRAY_WORD_BITS - offset) ? offset + (uint32_t)(last - first) : BITARRAY_WORD_BITS;
+        uint64_t mask = BitArray_wordMask(offset, end);
+        if (value)
+            ba->data[word] |= mask;
+        else
+            ba->data[word] &= ~mask;
+        first += end - offset;
+    }
+}
+
+static inline void BitArray_setRange(BitArrayRef ba, BitArrayIndex first, BitArrayIndex last) {
+    BitArray_writeRange(ba, first, last, true);
+}
+
+static inline void BitArray_clearRange(BitArrayRef ba, BitArrayIndex first, BitArrayIndex last) {
+    BitArray_writeRange(ba, first, last, false);
+}
+
+// The number of set bits in [first, last)
+static inline BitArrayIndex BitArray_countRange(BitArrayRef ba, BitArrayIndex first, BitArrayIndex last) {
+    BitArrayIndex count = 0;
+    while (first < last) {
+        BitArrayIndex word = first / BITARRAY_WORD_BITS;
+        uint32_t offset = first % BITARRAY_WORD_BITS;
+        uint32_t end = (last - first < BITARRAY_WORD_BITS - offset) ? offset + (uint32_t)(last - first) : BITARRAY_WORD_BITS;
+        count += (BitArrayIndex)__builtin_popcountll(ba->data[word] & BitArray_wordMask(offset, end));
+        first += end - offset;
+    }
+    return count;
+}
+
+static inline BitArrayIndex BitArray_count(BitArrayRef ba) {
+    return BitArray_countRange(ba, 0, ba->numBits);
+}
+
+// Returns the index of the first bit in [first, last) that is set (or clear, when value is false), or last if
+// there isn't one
+static inline BitArrayIndex BitArray_findNext(BitArrayRef ba, BitArrayIndex first, BitArrayIndex last, bool value) {
+    if (first >= last)
+        return last;
+    BitArrayIndex word = first / BITARRAY_WORD_BITS;
+    uint64_t flip = value ? 0 : ~(uint64_t)0;
+    uint64_t bits = (ba->data[word] ^ flip) & (~(uint64_t)0 << (first % BITARRAY_WORD_BITS));
+    BitArrayIndex lastWord = (last - 1) / BITARRAY_WORD_BITS;
+    while (!bits) {
+        if (++word > lastWord)
+            return last;
+        bits = ba->data[word] ^ flip;
+    }
+    BitArrayIndex index = word * BITARRAY_WORD_BITS + (BitArrayIndex)__builtin_ctzll(bits);
+    return (index < last) ? index : last;
+}
+
+static inline BitArrayIndex BitArray_findNextSet(BitArrayRef ba, BitArrayIndex first, BitArrayIndex last) {
+    return BitArray_findNext(ba, first, last, true);
 }
 
-static inline void BitArray_clearBit(BitArrayRef ba, uint32_t index) {
-    ba->data[index / 8] &= (1 << (index % 8)) ^ 0xFF;
+static inline BitArrayIndex BitArray_findNextClear(BitArrayRef ba, BitArrayIndex first, BitArrayIndex last) {
+    return BitArray_findNext(ba, first, last, false);
 }
 
-static inline bool BitArray_readBit(BitArrayRef ba, uint32_t index) {
-    return (ba->data[index / 8] & 1 << (index % 8));
+// Finds the first run of set bits (or clear bits, when value is false) that begins in [*first, last), and
+// stores where it begins in *first and where it ends in *end, clipped to last. Returns false if there isn't
+// one. For example:
+//     for (BitArrayIndex i = 0, end; BitArray_nextRun(ba, &i, &end, ba->numBits, true); i = end)
+//         ...bits [i, end) are all set...
+static inline bool BitArray_nextRun(BitArrayRef ba, BitArrayIndex *first, BitArrayIndex *end, BitArrayIndex last, bool value) {
+    *first = BitArray_findNext(ba, *first, last, value);
+    if (*first >= last)
+        return false;
+    *end = BitArray_findNext(ba, *first, last, !value);
+    return true;
 }
 
 #ifdef __cplusplus
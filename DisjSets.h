@@ -18,17 +18,24 @@ extern "C" {
 #include <stdbool.h>
 #include <string.h>
 
-typedef int32_t *DisjSetsRef;
+// Elements are int32_t, or int64_t when MAZE_64BIT is defined (see Maze.h)
+#ifdef MAZE_64BIT
+typedef int64_t DisjSetsIndex;
+#else
+typedef int32_t DisjSetsIndex;
+#endif
+
+typedef DisjSetsIndex *DisjSetsRef;
 
-static inline void DisjSets_reset(DisjSetsRef djs, uint32_t size) {
-    memset(djs, 0xFF, sizeof(int32_t) * size); // quickly sets all int32_t's to -1
+static inline void DisjSets_reset(DisjSetsRef djs, size_t size) {
+    memset(djs, 0xFF, sizeof(DisjSetsIndex) * size); // quickly sets all elements to -1
     // The intent of the above code is:
-    // for (uint32_t i = 0; i < size; ++i)
+    // for (size_t i = 0; i < size; ++i)
     //     djs[i] = -1;
 }
 
-static inline DisjSetsRef DisjSets_create(uint32_t size) {
-    DisjSetsRef djs = (DisjSetsRef)malloc(sizeof(int32_t) * size);
+static inline DisjSetsRef DisjSets_create(size_t size) {
+    DisjSetsRef djs = (DisjSetsRef)malloc(sizeof(DisjSetsIndex) * size);
     DisjSets_reset(djs, size);
     return djs;
 }
@@ -37,7 +44,7 @@ static inline void DisjSets_delete(DisjSetsRef djs) {
     free(djs);
 }
 
-static inline void DisjSets_union(DisjSetsRef djs, int32_t root1, int32_t root2) {
+static inline void DisjSets_union(DisjSetsRef djs, DisjSetsIndex root1, DisjSetsIndex root2) {
     if (djs[root2] < djs[root1])
         djs[root1] = root2;
     else {
@@ -47,8 +54,8 @@ static inline void DisjSets_union(DisjSetsRef djs, int32_t root1, int32_t root2)
     }
 }
 
-static inline int DisjSets_find(DisjSetsRef djs, int32_t x) {
-    int root, var, prevVar;
+static inline DisjSetsIndex DisjSets_find(DisjSetsRef djs, DisjSetsIndex x) {
+    DisjSetsIndex root, var, prevVar;
     root = var = x;
     while (djs[root] >= 0)
         root = djs[root];
@@ -60,7 +67,7 @@ static inline int DisjSets_find(DisjSetsRef djs, int32_t x) {
     return root;
 }
 
-static inline bool DisjSets_sameSet(DisjSetsRef djs, int32_t x, int32_t y) {
+static inline bool DisjSets_sameSet(DisjSetsRef djs, DisjSetsIndex x, DisjSetsIndex y) {
     return (DisjSets_find(djs, x) == DisjSets_find(djs, y));
 }
 
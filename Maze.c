@@ -6,23 +6,493 @@
  *
  */
 
+// For mmap(), madvise(), mkstemp(), posix_fallocate() and the like, which strict C and C++ modes hide
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE // madvise() and MADV_* on glibc
+#endif
+#ifndef _DARWIN_C_SOURCE
+#define _DARWIN_C_SOURCE // and on macOS
+#endif
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
+#include <errno.h>
 
 // For maximum portability, this file may be compiled as C++, or C, and it
 // will automatically switch between using pthreads or std::thread.
 
 #ifdef __cplusplus
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <system_error>
 #else
 #include <pthread.h>
+#include <sched.h>
+#endif
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef __BMI2__
+#include <immintrin.h>
 #endif
 
 #include "Maze.h"
+#include "AtomicDisjSets.h"
+
+// Borůvka's algorithm reuses the memory of m->sets for a concurrent union-find with elements of the same width
+#ifdef MAZE_64BIT
+typedef AtomicDisjSets64Ref ConcurrentSetsRef;
+#define ConcurrentSets_reset AtomicDisjSets64_reset
+#define ConcurrentSets_find AtomicDisjSets64_find
+#define ConcurrentSets_union AtomicDisjSets64_union
+#else
+typedef AtomicDisjSetsRef ConcurrentSetsRef;
+#define ConcurrentSets_reset AtomicDisjSets_reset
+#define ConcurrentSets_find AtomicDisjSets_find
+#define ConcurrentSets_union AtomicDisjSets_union
+#endif
+
+// The splitmix64 finalizer; it is a bijection, so distinct walls always receive distinct weights
+static inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// Mazes created in the same second (or even by different threads at the same time) must not share a seed
+static uint64_t entropySeed(const void *address) {
+    static uint64_t counter = 0;
+    uint64_t seed = (uint64_t)time(0);
+    seed = mix64(seed ^ (uint64_t)clock());
+    seed = mix64(seed ^ (uint64_t)(uintptr_t)address);
+    return mix64(seed ^ __atomic_add_fetch(&counter, 0x9E3779B97F4A7C15ULL, __ATOMIC_RELAXED));
+}
+
+typedef void *(*MazeThreadFunc)(void *);
+
+// Worker threads are started the first time a maze is generated or solved on more than one core, and are
+// parked between calls, so a batch of small mazes doesn't pay for creating threads over and over again.
+// The calling thread always works alongside them, so a maze using N cores keeps N - 1 of them.
+struct _MazeThreadPool {
+#ifdef __cplusplus
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::thread *threads;
+#else
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    pthread_t *threads;
+#endif
+    uint32_t threadCount;
+    bool quit;
+
+    // The current batch of jobs; job i is func(args + argSize * i)
+    MazeThreadFunc func;
+    uint8_t *args;
+    size_t argSize;
+    uint32_t jobCount;
+    uint32_t nextJob;
+    uint32_t finishedJobs;
+    uint64_t batch; // incremented for every batch, so parked threads can tell a new one apart from a spurious wakeup
+};
+typedef struct _MazeThreadPool MazeThreadPool;
+
+#ifdef __cplusplus
+
+// Runs jobs from the current batch until there are none left to start; the pool's mutex must be held
+static void runJobs(MazeThreadPool *pool, std::unique_lock<std::mutex> &lock) {
+    while (pool->nextJob < pool->jobCount) {
+        uint32_t job = pool->nextJob++;
+        lock.unlock();
+        pool->func((void*)(pool->args + pool->argSize * job));
+        lock.lock();
+        if (++pool->finishedJobs == pool->jobCount)
+            pool->done.notify_one();
+    }
+}
+
+static void poolThread(MazeThreadPool *pool) {
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    uint64_t batch = 0;
+    while (true) {
+        while (!pool->quit && pool->batch == batch)
+            pool->wake.wait(lock);
+        if (pool->quit)
+            break;
+        batch = pool->batch;
+        runJobs(pool, lock);
+    }
+}
+
+static void stopThreadPool(MazeThreadPool *pool, uint32_t started) {
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->quit = true;
+    }
+    pool->wake.notify_all();
+    for (uint32_t i = 0; i < started; ++i)
+        pool->threads[i].join();
+    delete [] pool->threads;
+    delete pool;
+}
+
+static MazeThreadPool *createThreadPool(uint32_t threadCount) {
+    MazeThreadPool *pool = new MazeThreadPool();
+    pool->threads = new std::thread[threadCount];
+    pool->threadCount = threadCount;
+    pool->quit = false;
+    pool->jobCount = pool->nextJob = pool->finishedJobs = 0;
+    pool->batch = 0;
+    for (uint32_t i = 0; i < threadCount; ++i) {
+        try {
+            pool->threads[i] = std::thread(poolThread, pool);
+        } catch (const std::system_error &e) {
+            fprintf(stderr, "Error: std::thread() threw '%s'\n", e.what());
+            stopThreadPool(pool, i);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+// Runs func on count threads, passing each one its own element of the args array, and waits for all of them to finish
+static void runThreads(MazeRef m, MazeThreadFunc func, void *args, size_t argSize, uint32_t count) {
+    MazeThreadPool *pool = m->pool;
+    if (count == 1 || !pool) {
+        for (uint32_t i = 0; i < count; ++i)
+            func((void*)((uint8_t*)args + argSize * i));
+        return;
+    }
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    pool->func = func;
+    pool->args = (uint8_t*)args;
+    pool->argSize = argSize;
+    pool->jobCount = count;
+    pool->nextJob = pool->finishedJobs = 0;
+    pool->batch++;
+    pool->wake.notify_all();
+    runJobs(pool, lock);
+    while (pool->finishedJobs < pool->jobCount)
+        pool->done.wait(lock);
+}
+
+static void yieldThread(void) {
+    std::this_thread::yield();
+}
+
+#else
+
+// Runs jobs from the current batch until there are none left to start; the pool's mutex must be held
+static void runJobs(MazeThreadPool *pool) {
+    while (pool->nextJob < pool->jobCount) {
+        uint32_t job = pool->nextJob++;
+        pthread_mutex_unlock(&pool->mutex);
+        pool->func((void*)(pool->args + pool->argSize * job));
+        pthread_mutex_lock(&pool->mutex);
+        if (++pool->finishedJobs == pool->jobCount)
+            pthread_cond_signal(&pool->done);
+    }
+}
+
+static void *poolThread(void *arg) {
+    MazeThreadPool *pool = (MazeThreadPool*)arg;
+    pthread_mutex_lock(&pool->mutex);
+    uint64_t batch = 0;
+    while (true) {
+        while (!pool->quit && pool->batch == batch)
+            pthread_cond_wait(&pool->wake, &pool->mutex);
+        if (pool->quit)
+            break;
+        batch = pool->batch;
+        runJobs(pool);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return 0;
+}
+
+static void stopThreadPool(MazeThreadPool *pool, uint32_t started) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->quit = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->mutex);
+    for (uint32_t i = 0; i < started; ++i)
+        pthread_join(pool->threads[i], NULL);
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool->threads);
+    free(pool);
+}
+
+static MazeThreadPool *createThreadPool(uint32_t threadCount) {
+    MazeThreadPool *pool = (MazeThreadPool*)malloc(sizeof(MazeThreadPool));
+    pool->threads = (pthread_t*)malloc(sizeof(pthread_t) * threadCount);
+    pool->threadCount = threadCount;
+    pool->quit = false;
+    pool->jobCount = pool->nextJob = pool->finishedJobs = 0;
+    pool->batch = 0;
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    for (uint32_t i = 0; i < threadCount; ++i) {
+        int rc = pthread_create(&pool->threads[i], NULL, poolThread, pool);
+        if (rc) {
+            fprintf(stderr, "Error: pthread_create() returned code %d\n", rc);
+            stopThreadPool(pool, i);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+// Runs func on count threads, passing each one its own element of the args array, and waits for all of them to finish
+static void runThreads(MazeRef m, MazeThreadFunc func, void *args, size_t argSize, uint32_t count) {
+    MazeThreadPool *pool = m->pool;
+    if (count == 1 || !pool) {
+        for (uint32_t i = 0; i < count; ++i)
+            func((void*)((uint8_t*)args + argSize * i));
+        return;
+    }
+    pthread_mutex_lock(&pool->mutex);
+    pool->func = func;
+    pool->args = (uint8_t*)args;
+    pool->argSize = argSize;
+    pool->jobCount = count;
+    pool->nextJob = pool->finishedJobs = 0;
+    pool->batch++;
+    pthread_cond_broadcast(&pool->wake);
+    runJobs(pool);
+    while (pool->finishedJobs < pool->jobCount)
+        pthread_cond_wait(&pool->done, &pool->mutex);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+static void yieldThread(void) {
+    sched_yield();
+}
+
+#endif
+
+// Makes sure the maze has a worker thread for every core but the calling thread's one, replacing its pool if
+// Maze_setCores() changed since it was started. Returns false if the threads could not be started.
+static bool startThreadPool(MazeRef m) {
+    uint32_t threadCount = m->cores - 1;
+    if (m->pool && m->pool->threadCount == threadCount)
+        return true;
+    if (m->pool) {
+        stopThreadPool(m->pool, m->pool->threadCount);
+        m->pool = NULL;
+    }
+    if (threadCount == 0)
+        return true;
+    m->pool = createThreadPool(threadCount);
+    return m->pool != NULL;
+}
+
+typedef enum _ArrayAccess {
+    aaNormal,
+    aaSequential, // read far ahead, and drop pages soon after they have been passed
+    aaRandom, // don't read ahead at all
+} ArrayAccess;
+
+// Tells the kernel how an array of a mapped maze is about to be used, so it can page it in and out accordingly
+static void adviseArray(MazeRef m, void *array, size_t size, ArrayAccess access) {
+#ifndef _WIN32
+    if (!m->backingDirectory || !array)
+        return;
+    int advice = (access == aaSequential) ? MADV_SEQUENTIAL : (access == aaRandom) ? MADV_RANDOM : MADV_NORMAL;
+    madvise(array, size ? size : 1, advice);
+#else
+    (void)m; (void)array; (void)size; (void)access;
+#endif
+}
+
+// Each array of a maze made by Maze_createMapped() lives in a file of its own, which is unlinked as soon as it is
+// made, so the kernel can write its pages out to disk instead of running out of memory, and the disk space is given
+// back when it is unmapped, however the program ends. Returns NULL if it could not be allocated.
+static void *allocateArray(MazeRef m, size_t size, ArrayAccess access) {
+    if (!m->backingDirectory)
+        return malloc(size ? size : 1);
+#ifndef _WIN32
+    size_t pathLength = strlen(m->backingDirectory) + sizeof("/maze-XXXXXX");
+    char *path = (char*)malloc(pathLength);
+    snprintf(path, pathLength, "%s/maze-XXXXXX", m->backingDirectory);
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        fprintf(stderr, "Error: could not create a file in '%s': %s\n", m->backingDirectory, strerror(errno));
+        free(path);
+        return NULL;
+    }
+    unlink(path);
+    free(path);
+
+    // Reserving every block up front turns a full disk into an error here, instead of a SIGBUS partway through
+    void *array = MAP_FAILED;
+    int error = posix_fallocate(fd, 0, (off_t)(size ? size : 1));
+    if (!error) {
+        array = mmap(NULL, size ? size : 1, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (array == MAP_FAILED)
+            error = errno;
+    }
+    close(fd);
+    if (error) {
+        fprintf(stderr, "Error: could not map %llu bytes in '%s': %s\n", (unsigned long long)size, m->backingDirectory, strerror(error));
+        return NULL;
+    }
+    adviseArray(m, array, size, access);
+    return array;
+#else
+    (void)access;
+    fprintf(stderr, "Error: mapped mazes are not supported on this platform\n");
+    return NULL;
+#endif
+}
+
+static void freeArray(MazeRef m, void *array, size_t size) {
+    if (!array)
+        return;
+#ifndef _WIN32
+    if (m->backingDirectory) {
+        munmap(array, size ? size : 1);
+        return;
+    }
+#else
+    (void)size;
+#endif
+    free(array);
+}
+
+static BitArrayRef createBitArray(MazeRef m, MazeIndex numBits) {
+    if (!m->backingDirectory)
+        return BitArray_create(numBits, false);
+    BitArrayRef ba = (BitArrayRef)malloc(sizeof(BitArray));
+    ba->numBits = numBits;
+    ba->data_length = BitArray_wordCount(numBits);
+    ba->data = (uint64_t*)allocateArray(m, sizeof(uint64_t) * ba->data_length, aaNormal);
+    if (!ba->data) {
+        free(ba);
+        return NULL;
+    }
+    return ba;
+}
+
+typedef enum _TileState {
+    tsLeft,
+    tsDecoding,
+    tsDecoded,
+} TileState;
+
+struct _MazeTiles {
+    uint8_t *file; // the whole file, mapped into memory (or read into it, where files can't be mapped)
+    uint64_t fileSize;
+    uint64_t indexOffset; // where tileOffsets[] starts in the file
+    uint32_t *tileDims; // the size of a whole tile in each dimension (tiles at the far edges may be smaller)
+    uint32_t *tileCounts; // the number of tiles along each dimension
+    MazeIndex totalTiles;
+    bool solution; // whether the tiles hold the solution as well as the maze
+    uint8_t *states; // the TileState of each tile
+    MazeIndex tilesLeft; // how many tiles haven't been decoded yet
+};
+typedef struct _MazeTiles MazeTiles;
+
+static void waitForTile(MazeTiles *tiles, MazeIndex tile) {
+    while (__atomic_load_n(&tiles->states[tile], __ATOMIC_ACQUIRE) != tsDecoded)
+        yieldThread();
+}
+
+static void deleteTiles(MazeTiles *tiles) {
+    if (!tiles)
+        return;
+#ifndef _WIN32
+    if (tiles->file)
+        munmap(tiles->file, (size_t)tiles->fileSize);
+#else
+    free(tiles->file);
+#endif
+    free(tiles->tileDims);
+    free(tiles->states);
+    free(tiles);
+}
+
+// Makes sure nobody decodes the tiles that are left into the maze after it is generated again
+static void discardTiles(MazeRef m) {
+    MazeTiles *tiles = m->tiles;
+    if (!tiles)
+        return;
+    for (MazeIndex tile = 0; tile < tiles->totalTiles; ++tile) {
+        uint8_t expected = tsLeft;
+        if (!__atomic_compare_exchange_n(&tiles->states[tile], &expected, (uint8_t)tsDecoded, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            waitForTile(tiles, tile);
+    }
+    m->tiles = NULL;
+    deleteTiles(tiles);
+}
+
+static void deleteBitArray(MazeRef m, BitArrayRef ba) {
+    if (!ba)
+        return;
+    if (m->file && (uint8_t*)ba->data >= (uint8_t*)m->file && (uint8_t*)ba->data < (uint8_t*)m->file + m->fileSize) {
+        free(ba); // it points into the file Maze_load() mapped
+        return;
+    }
+    if (!m->backingDirectory) {
+        BitArray_delete(ba);
+        return;
+    }
+    freeArray(m, ba->data, sizeof(uint64_t) * ba->data_length);
+    free(ba);
+}
+
+// The last cell must still fit in a MazeIndex after being shifted left by wallShift bits (see Maze.h), and
+// DisjSets stores elements as signed integers, so at least one bit is always kept spare
+bool Maze_canCreate(const uint32_t *dims, uint32_t length) {
+    uint32_t wallShift = 1;
+    while ((1u << wallShift) < length)
+        wallShift++;
+    uint64_t totalPositions = 1;
+    for (uint32_t i = 0; i < length; ++i) {
+        if (dims[i] && totalPositions > UINT64_MAX / dims[i])
+            return false;
+        totalPositions *= dims[i];
+    }
+    return totalPositions == 0 || totalPositions - 1 <= (MAZE_INDEX_MAX >> wallShift);
+}
+
+// A bit array without any data, for Maze_load() to point into the file it maps
+static BitArrayRef createEmptyBitArray(MazeIndex numBits) {
+    BitArrayRef ba = (BitArrayRef)malloc(sizeof(BitArray));
+    ba->numBits = numBits;
+    ba->data_length = BitArray_wordCount(numBits);
+    ba->data = NULL;
+    return ba;
+}
+
+// Without allocateHalls, halls[] and solution[] are left without any data
+static MazeRef createMaze(uint32_t *dims, uint32_t length, MazeCreateFlags flags, const char *directory, bool allocateHalls) {
+    if (!Maze_canCreate(dims, length)) {
+        uint64_t totalPositions = 1;
+        for (uint32_t i = 0; i < length; ++i)
+            totalPositions *= dims[i];
+        fprintf(stderr, "Error: Maze_create cannot create a maze with %llu cells\n", (unsigned long long)totalPositions);
+        return NULL;
+    }
 
-MazeRef Maze_create(uint32_t *dims, uint32_t length, MazeCreateFlags flags) {
     MazeRef m;
     m = (MazeRef)malloc(sizeof(Maze));
     m->totalPositions = 1;
@@ -32,72 +502,118 @@ MazeRef Maze_create(uint32_t *dims, uint32_t length, MazeCreateFlags flags) {
     m->dims = (uint32_t*)malloc(sizeof(uint32_t) * length);
     m->dims_length = length;
     memcpy(m->dims, dims, sizeof(uint32_t) * length);
+    m->placeValues = (MazeIndex*)malloc(sizeof(MazeIndex) * length);
+    m->wallShift = 0;
+    while ((1u << m->wallShift) < length)
+        m->wallShift++;
     m->halls = m->solution = NULL;
     m->createFlags = flags;
     m->sets = NULL;
+    m->backingDirectory = directory ? strdup(directory) : NULL;
+    m->file = NULL;
+    m->fileSize = 0;
+    m->tiles = NULL;
     m->needsNeighborCountRefreshed = false;
+    m->needsLotteryRefreshed = false;
     m->solutionLength = m->start = m->end = 0;
     m->cores = 1; // default to single core solves; for multi-core solves, call Maze_setCores() after calling Maze_create()
+    m->pool = NULL;
+    // Kruskal's algorithm and dead-end filling jump all over the lottery, which is slow once it's on disk
+    m->algorithm = directory ? maBoruvka : maKruskal;
+    m->solver = directory ? msWorklist : msDeadEndFill;
+    m->seed = entropySeed(m);
+    m->seedUsed = false;
+    Random_seed(&m->random, m->seed);
 
-    for (uint32_t i = 0; i < length; ++i)
+    for (uint32_t i = 0; i < length; ++i) {
+        m->placeValues[i] = m->totalPositions;
         m->totalPositions *= dims[i];
+    }
 
     for (uint32_t i = 0; i < length; ++i) {
-        uint32_t subTotal = 1;
+        MazeIndex subTotal = 1;
         for (uint32_t j = 0; j < length; ++j)
             if (j != i)
                 subTotal *= dims[j];
         m->totalWalls += subTotal * (dims[i] - 1);
     }
 
-    m->lottery = (Wall*)malloc(sizeof(Wall) * m->totalWalls);
+    m->lottery = (Wall*)allocateArray(m, sizeof(Wall) * m->totalWalls, aaSequential);
+    bool allocated = m->lottery != NULL;
 
-    if (m->createFlags & mcfOutputSolution)
-        m->neighborCount = (unsigned char*)malloc(sizeof(uint8_t) * m->totalPositions);
+    if (allocated && (m->createFlags & mcfOutputSolution)) {
+        m->neighborCount = (unsigned char*)allocateArray(m, sizeof(uint8_t) * m->totalPositions, aaNormal);
+        allocated = m->neighborCount != NULL;
+    }
 
-    if (m->createFlags & mcfMultipleSolves)
-        m->neighborCountCopy = (unsigned char*)malloc(sizeof(uint8_t) * m->totalPositions);
+    if (allocated && (m->createFlags & mcfMultipleSolves)) {
+        m->neighborCountCopy = (unsigned char*)allocateArray(m, sizeof(uint8_t) * m->totalPositions, aaSequential);
+        allocated = m->neighborCountCopy != NULL;
+    }
 
-    m->sets = DisjSets_create(m->totalPositions);
+    // Maze_generate() resets the sets before each use
+    if (allocated) {
+        m->sets = (DisjSetsRef)allocateArray(m, sizeof(DisjSetsIndex) * m->totalPositions, aaRandom);
+        allocated = m->sets != NULL;
+    }
 
     if (m->createFlags & mcfOutputMaze) {
         m->halls = (BitArrayRef*)malloc(sizeof(BitArrayRef) * m->dims_length);
-        for (unsigned int i = 0; i < m->dims_length; ++i)
-            m->halls[i] = BitArray_create(m->totalPositions, false);
+        for (unsigned int i = 0; i < m->dims_length; ++i) {
+            m->halls[i] = !allocated ? NULL : allocateHalls ? createBitArray(m, m->totalPositions) : createEmptyBitArray(m->totalPositions);
+            allocated = m->halls[i] != NULL;
+        }
     }
     if (m->createFlags & mcfOutputSolution) {
         m->solution = (BitArrayRef*)malloc(sizeof(BitArrayRef) * m->dims_length);
-        for (uint32_t i = 0; i < m->dims_length; ++i)
-            m->solution[i] = BitArray_create(m->totalPositions, false);
+        for (uint32_t i = 0; i < m->dims_length; ++i) {
+            m->solution[i] = !allocated ? NULL : allocateHalls ? createBitArray(m, m->totalPositions) : createEmptyBitArray(m->totalPositions);
+            allocated = m->solution[i] != NULL;
+        }
     }
 
-    srandom(time(0));
-
+    if (!allocated) {
+        Maze_delete(m);
+        return NULL;
+    }
     return m;
 }
 
+MazeRef Maze_create(uint32_t *dims, uint32_t length, MazeCreateFlags flags) {
+    return createMaze(dims, length, flags, NULL, true);
+}
+
+MazeRef Maze_createMapped(uint32_t *dims, uint32_t length, MazeCreateFlags flags, const char *directory) {
+    return createMaze(dims, length, flags, directory, true);
+}
+
 void Maze_delete(MazeRef m) {
     if (!m)
         return;
+    if (m->pool)
+        stopThreadPool(m->pool, m->pool->threadCount);
     free(m->dims);
-    if (m->sets)
-        DisjSets_delete(m->sets);
-    if (m->neighborCount)
-        free(m->neighborCount);
-    if (m->neighborCountCopy)
-        free(m->neighborCountCopy);
-    if (m->lottery)
-        free(m->lottery);
+    free(m->placeValues);
+    freeArray(m, m->sets, sizeof(DisjSetsIndex) * m->totalPositions);
+    freeArray(m, m->neighborCount, sizeof(uint8_t) * m->totalPositions);
+    freeArray(m, m->neighborCountCopy, sizeof(uint8_t) * m->totalPositions);
+    freeArray(m, m->lottery, sizeof(Wall) * m->totalWalls);
     if (m->halls) {
         for (uint32_t i = 0; i < m->dims_length; ++i)
-            BitArray_delete(m->halls[i]);
+            deleteBitArray(m, m->halls[i]);
         free(m->halls);
     }
     if (m->solution) {
         for (uint32_t i = 0; i < m->dims_length; ++i)
-            BitArray_delete(m->solution[i]);
+            deleteBitArray(m, m->solution[i]);
         free(m->solution);
     }
+#ifndef _WIN32
+    if (m->file)
+        munmap(m->file, m->fileSize);
+#endif
+    deleteTiles(m->tiles);
+    free(m->backingDirectory);
     free(m);
 }
 
@@ -106,169 +622,926 @@ void Maze_setCores(MazeRef m, uint32_t value) {
         m->cores = value;
 }
 
-void Maze_generate(MazeRef m) {
-    if (!m || !m->totalPositions)
-        return;
+void Maze_setAlgorithm(MazeRef m, MazeAlgorithm algorithm) {
+    m->algorithm = algorithm;
+}
 
-    uint32_t lotteryIndex = 0;
-    for (uint32_t position = 0; position < m->totalPositions; ++position) {
-        int placeValue = 1;
-        for (uint32_t i = 0; i < m->dims_length; ++i) {
-            uint32_t valueForThisDim = (position / placeValue) % m->dims[i];
-            if (valueForThisDim < m->dims[i] - 1) {
-                m->lottery[lotteryIndex].cell1 = position;
-                m->lottery[lotteryIndex].cell2 = position + placeValue;
-                lotteryIndex++;
-            }
-            placeValue *= m->dims[i];
-        }
-    }
+void Maze_setSolver(MazeRef m, MazeSolver solver) {
+    m->solver = solver;
+}
 
-    DisjSets_reset(m->sets, m->totalPositions);
+// The same seed, dimensions and algorithm always reproduce the same maze, regardless of the number of cores
+void Maze_setSeed(MazeRef m, uint64_t seed) {
+    m->seed = seed;
+    m->seedUsed = false;
+}
 
-    uint32_t lotteryExtent = m->totalWalls;
-    uint32_t knockedOutWalls = 0;
+static inline void atomicMin64(uint64_t *address, uint64_t value) {
+    uint64_t current = __atomic_load_n(address, __ATOMIC_RELAXED);
+    while (value < current && !__atomic_compare_exchange_n(address, &current, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
 
-    if (m->createFlags & mcfOutputSolution) {
-        memset(m->neighborCount, 0, sizeof(uint8_t) * m->totalPositions);
-        m->needsNeighborCountRefreshed = false;
+#define BORUVKA_NO_WALL UINT64_MAX
 
-        while (knockedOutWalls < m->totalPositions - 1) {
-            uint32_t r = (uint32_t)( (float)(lotteryExtent - knockedOutWalls) * random() / (RAND_MAX + 1.0) ) + knockedOutWalls;
-            int32_t root1 = DisjSets_find(m->sets, m->lottery[r].cell1);
-            int32_t root2 = DisjSets_find(m->sets, m->lottery[r].cell2);
-            if (root1 != root2) {
-                DisjSets_union(m->sets, root1, root2);
-                m->neighborCount[m->lottery[r].cell1]++;
-                m->neighborCount[m->lottery[r].cell2]++;
-                Wall tmp = m->lottery[knockedOutWalls];
-                m->lottery[knockedOutWalls] = m->lottery[r];
-                m->lottery[r] = tmp;
-                knockedOutWalls++;
-            } else {
-                m->lottery[r] = m->lottery[lotteryExtent - 1];
-                lotteryExtent--;
+typedef enum _BoruvkaPass {
+    bpInitialize,
+    bpFindLightest,
+    bpSelect,
+    bpUnion,
+    bpReset,
+    bpCount,
+    bpCollect,
+} BoruvkaPass;
+
+typedef struct _BoruvkaInfo {
+    MazeRef m;
+    BoruvkaPass pass;
+    ConcurrentSetsRef parent; // shares memory with m->sets
+    uint64_t *lightest; // the lightest wall touching each component, indexed by its root
+    BitArrayRef *knockedOut; // the walls chosen so far, in the same layout as m->halls
+    uint64_t seed;
+    MazeIndex startWall; // this thread's slice of the lottery, which shrinks as walls inside a component are discarded
+    MazeIndex endWall;
+    MazeIndex startPosition; // this thread's slice of the maze, for the per-position passes
+    MazeIndex endPosition;
+    MazeIndex knockedOutWalls; // walls knocked out by this thread (bpUnion), or found in its slice of the maze (bpCount)
+    MazeIndex writeAt; // where this thread's slice of knocked out walls begins in the lottery (bpCollect)
+} BoruvkaInfo;
+
+static inline uint64_t boruvkaWeight(const BoruvkaInfo *bi, Wall wall) {
+    return mix64(wall ^ bi->seed);
+}
+
+static void *boruvkaThreaded(void *arg) {
+    BoruvkaInfo *bi = (BoruvkaInfo*)arg;
+    MazeRef m = bi->m;
+
+    switch (bi->pass) {
+    case bpInitialize: {
+        ConcurrentSets_reset(bi->parent, bi->startPosition, bi->endPosition);
+        for (MazeIndex position = bi->startPosition; position < bi->endPosition; ++position)
+            bi->lightest[position] = BORUVKA_NO_WALL;
+        // The lottery is laid out one dimension after another, so the cell on the near side of any wall can be
+        // computed directly from its index, without needing to count the walls that came before it.
+        MazeIndex laneStart = 0;
+        MazeIndex placeValue = 1;
+        for (uint32_t d = 0; d < m->dims_length; ++d) {
+            MazeIndex span = placeValue * (m->dims[d] - 1); // consecutive cells that have a wall in this dimension
+            MazeIndex laneLength = (m->totalPositions / (placeValue * m->dims[d])) * span;
+            MazeIndex first = bi->startWall > laneStart ? bi->startWall : laneStart;
+            MazeIndex last = bi->endWall < laneStart + laneLength ? bi->endWall : laneStart + laneLength;
+            if (first < last) {
+                MazeIndex offset = (first - laneStart) % span;
+                MazeIndex cell = (first - laneStart) / span * placeValue * m->dims[d] + offset;
+                for (MazeIndex i = first; i < last; ++i) {
+                    m->lottery[i] = Maze_packWall(m, cell, d);
+                    cell++;
+                    if (++offset == span) {
+                        offset = 0;
+                        cell += placeValue;
+                    }
+                }
             }
+            laneStart += laneLength;
+            placeValue *= m->dims[d];
         }
-    } else {
-        while (knockedOutWalls < m->totalPositions - 1) {
-            uint32_t r = (uint32_t)( (float)(lotteryExtent - knockedOutWalls) * random() / (RAND_MAX + 1.0) ) + knockedOutWalls;
-            int root1 = DisjSets_find(m->sets, m->lottery[r].cell1);
-            int root2 = DisjSets_find(m->sets, m->lottery[r].cell2);
+        break;
+    }
+    case bpFindLightest: {
+        // Discard walls that no longer separate two components, and record the lightest wall touching each component
+        MazeIndex writeAt = bi->startWall;
+        for (MazeIndex i = bi->startWall; i < bi->endWall; ++i) {
+            Wall wall = m->lottery[i];
+            MazeIndex root1 = ConcurrentSets_find(bi->parent, Maze_wallCell1(m, wall));
+            MazeIndex root2 = ConcurrentSets_find(bi->parent, Maze_wallCell2(m, wall));
             if (root1 != root2) {
-                DisjSets_union(m->sets, root1, root2);
-                Wall tmp = m->lottery[knockedOutWalls];
-                m->lottery[knockedOutWalls] = m->lottery[r];
-                m->lottery[r] = tmp;
-                knockedOutWalls++;
-            } else {
-                m->lottery[r] = m->lottery[lotteryExtent - 1];
-                lotteryExtent--;
+                uint64_t weight = boruvkaWeight(bi, wall);
+                atomicMin64(&bi->lightest[root1], weight);
+                atomicMin64(&bi->lightest[root2], weight);
+                m->lottery[writeAt++] = wall;
             }
         }
+        bi->endWall = writeAt;
+        break;
     }
-
-    if (m->createFlags & mcfOutputMaze) {
-        for (uint32_t i = 0; i < m->dims_length; ++i)
-            BitArray_reset(m->halls[i]);
-
-        for (uint32_t i = 0; i < knockedOutWalls; ++i) {
-            uint32_t placeValue = 1;
+    case bpSelect:
+        // No unions happen during this pass, so every root found here is the one bpFindLightest saw
+        for (MazeIndex i = bi->startWall; i < bi->endWall; ++i) {
+            Wall wall = m->lottery[i];
+            uint64_t weight = boruvkaWeight(bi, wall);
+            if (bi->lightest[ConcurrentSets_find(bi->parent, Maze_wallCell1(m, wall))] == weight || bi->lightest[ConcurrentSets_find(bi->parent, Maze_wallCell2(m, wall))] == weight)
+                BitArray_setBitAtomic(bi->knockedOut[Maze_wallDim(m, wall)], Maze_wallCell1(m, wall));
+        }
+        break;
+    case bpUnion:
+        // Any wall still in the lottery that is marked was selected this round, since older ones were discarded
+        bi->knockedOutWalls = 0;
+        for (MazeIndex i = bi->startWall; i < bi->endWall; ++i) {
+            Wall wall = m->lottery[i];
+            if (BitArray_readBit(bi->knockedOut[Maze_wallDim(m, wall)], Maze_wallCell1(m, wall)) && ConcurrentSets_union(bi->parent, Maze_wallCell1(m, wall), Maze_wallCell2(m, wall)))
+                bi->knockedOutWalls++;
+        }
+        break;
+    case bpReset:
+        if (m->backingDirectory) {
+            // Once the maze is on disk, one sweep over this thread's slice of it beats finding the components of
+            // each wall left in the lottery, and leaves every cell pointing straight at its root for the next round
+            for (MazeIndex position = bi->startPosition; position < bi->endPosition; ++position) {
+                MazeIndex root = ConcurrentSets_find(bi->parent, position);
+                if (__atomic_load_n(&bi->parent[position], __ATOMIC_RELAXED) != root)
+                    __atomic_store_n(&bi->parent[position], root, __ATOMIC_RELAXED);
+                bi->lightest[position] = BORUVKA_NO_WALL;
+            }
+            break;
+        }
+        for (MazeIndex i = bi->startWall; i < bi->endWall; ++i) {
+            bi->lightest[ConcurrentSets_find(bi->parent, Maze_wallCell1(m, m->lottery[i]))] = BORUVKA_NO_WALL;
+            bi->lightest[ConcurrentSets_find(bi->parent, Maze_wallCell2(m, m->lottery[i]))] = BORUVKA_NO_WALL;
+        }
+        break;
+    case bpCount:
+    case bpCollect: {
+        uint32_t *coords = (uint32_t*)malloc(sizeof(uint32_t) * m->dims_length);
+        MazeIndex placeValue = 1;
+        for (uint32_t d = 0; d < m->dims_length; ++d) {
+            coords[d] = (bi->startPosition / placeValue) % m->dims[d];
+            placeValue *= m->dims[d];
+        }
+        MazeIndex knockedOutWalls = 0;
+        for (MazeIndex position = bi->startPosition; position < bi->endPosition; ++position) {
+            uint8_t neighbors = 0;
+            placeValue = 1;
             for (uint32_t d = 0; d < m->dims_length; ++d) {
-                if (m->dims[d] == 1)
-                    continue;
-                if (m->lottery[i].cell2 == m->lottery[i].cell1 + placeValue) {
-                    BitArray_setBit(m->halls[d], m->lottery[i].cell1);
-                    break;
+                if (coords[d] < m->dims[d] - 1 && BitArray_readBit(bi->knockedOut[d], position)) {
+                    if (bi->pass == bpCollect)
+                        m->lottery[bi->writeAt + knockedOutWalls] = Maze_packWall(m, position, d);
+                    knockedOutWalls++;
+                    neighbors++;
                 }
+                if (coords[d] > 0 && BitArray_readBit(bi->knockedOut[d], position - placeValue))
+                    neighbors++;
                 placeValue *= m->dims[d];
             }
+            if (bi->pass == bpCount && m->neighborCount)
+                m->neighborCount[position] = neighbors;
+            for (uint32_t d = 0; d < m->dims_length; ++d) { // advance to the coordinates of the next position
+                if (++coords[d] < m->dims[d])
+                    break;
+                coords[d] = 0;
+            }
         }
+        bi->knockedOutWalls = knockedOutWalls;
+        free(coords);
+        break;
+    }
     }
+
+    return 0;
 }
 
-typedef struct _DeadEndFillInfo {
-    MazeRef m;
-    uint32_t startWall;
-    uint32_t endWall;
-    uint32_t knockedOutWalls;
-} DeadEndFillInfo;
+// Rebuilds the beginning of the lottery from the walls marked in bi->knockedOut (sorted by position, like
+// Maze_solve() expects), and counts each cell's neighbors along the way, over each thread's slice of the maze
+static void collectKnockedOutWalls(MazeRef m, BoruvkaInfo *bi, uint32_t threads) {
+    for (uint32_t i = 0; i < threads; ++i)
+        bi[i].pass = bpCount;
+    runThreads(m, boruvkaThreaded, bi, sizeof(BoruvkaInfo), threads);
+    MazeIndex writeAt = 0;
+    for (uint32_t i = 0; i < threads; ++i) {
+        bi[i].pass = bpCollect;
+        bi[i].writeAt = writeAt;
+        writeAt += bi[i].knockedOutWalls;
+    }
+    runThreads(m, boruvkaThreaded, bi, sizeof(BoruvkaInfo), threads);
+}
 
-void *deadEndFillThreaded(void *arg) {
-    DeadEndFillInfo *defi = (DeadEndFillInfo*)arg;
+// Frees the bit arrays generateBoruvka() and generateTiled() mark walls in, unless they are m->halls
+static void deleteKnockedOut(MazeRef m, BitArrayRef *knockedOut) {
+    if (knockedOut == m->halls)
+        return;
+    for (uint32_t i = 0; i < m->dims_length; ++i)
+        deleteBitArray(m, knockedOut[i]);
+    free(knockedOut);
+}
 
-    uint32_t knockedOutWalls = defi->endWall;
-    while (true) {
-        bool filledDeadEnd = false;
-        for (uint32_t i = defi->startWall; i < knockedOutWalls; ++i) {
-            const uint32_t cell1 = defi->m->lottery[i].cell1;
-            const uint32_t cell2 = defi->m->lottery[i].cell2;
-            if ((defi->m->neighborCount[cell1] == 1 && cell1 != defi->m->start && cell1 != defi->m->end) || (defi->m->neighborCount[cell2] == 1 && cell2 != defi->m->start && cell2 != defi->m->end)) {
-                __atomic_fetch_sub(&defi->m->neighborCount[cell1], 1, __ATOMIC_SEQ_CST); // defi->m->neighborCount[cell1]--;
-                __atomic_fetch_sub(&defi->m->neighborCount[cell2], 1, __ATOMIC_SEQ_CST); // defi->m->neighborCount[cell2]--;
-                filledDeadEnd = true;
-                Wall tmp = defi->m->lottery[knockedOutWalls - 1]; // swap to the end of the knocked out wall part of the list
-                defi->m->lottery[knockedOutWalls - 1] = defi->m->lottery[i];
-                defi->m->lottery[i] = tmp;
-                knockedOutWalls--;
-            }
+// Borůvka's algorithm finds the minimum spanning tree of the maze's graph after giving every wall a random
+// weight, which is the same tree that Kruskal's algorithm finds when it visits the walls in a random order.
+// Unlike Kruskal's algorithm, each round of it can be split across as many threads as there are cores.
+static bool generateBoruvka(MazeRef m) {
+    uint32_t threads = m->cores;
+    if (m->totalWalls < threads || m->totalPositions < threads)
+        threads = 1;
+
+    bool allocated = true;
+    BitArrayRef *knockedOut = m->halls;
+    if (!(m->createFlags & mcfOutputMaze)) {
+        knockedOut = (BitArrayRef*)malloc(sizeof(BitArrayRef) * m->dims_length);
+        for (uint32_t i = 0; i < m->dims_length; ++i) {
+            knockedOut[i] = createBitArray(m, m->totalPositions);
+            allocated = allocated && knockedOut[i];
         }
-        if (!filledDeadEnd)
-            break;
     }
-    defi->knockedOutWalls = knockedOutWalls - defi->startWall;
 
-    return 0;
-}
+    uint64_t *lightest = (uint64_t*)allocateArray(m, sizeof(uint64_t) * m->totalPositions, aaRandom);
+    if (!allocated || !lightest) {
+        freeArray(m, lightest, sizeof(uint64_t) * m->totalPositions);
+        deleteKnockedOut(m, knockedOut);
+        return false;
+    }
+    for (uint32_t i = 0; i < m->dims_length; ++i)
+        BitArray_reset(knockedOut[i]);
 
-void Maze_solve(MazeRef m, uint32_t start, uint32_t end) {
-    if (!(m->createFlags & mcfOutputSolution)) {
-        fprintf(stderr, "Error: Maze_solve cannot be called without setting mcfOutputSolution in Maze_create\n");
-        return;
+    BoruvkaInfo *bi = (BoruvkaInfo*)malloc(sizeof(BoruvkaInfo) * threads);
+    uint64_t seed = Random_next(&m->random);
+    MazeIndex wallChunkSize = m->totalWalls / threads;
+    MazeIndex positionChunkSize = m->totalPositions / threads;
+    for (uint32_t i = 0; i < threads; ++i) {
+        bi[i].m = m;
+        bi[i].parent = (ConcurrentSetsRef)m->sets;
+        bi[i].lightest = lightest;
+        bi[i].knockedOut = knockedOut;
+        bi[i].seed = seed;
+        bi[i].startWall = i * wallChunkSize;
+        bi[i].endWall = (i == threads - 1) ? m->totalWalls : (i + 1) * wallChunkSize;
+        bi[i].startPosition = i * positionChunkSize;
+        bi[i].endPosition = (i == threads - 1) ? m->totalPositions : (i + 1) * positionChunkSize;
+        bi[i].knockedOutWalls = 0;
+        bi[i].writeAt = 0;
     }
 
-    if (!m || !m->lottery || !m->neighborCount)
-        return;
+#define BORUVKA_PASS(p) do { for (uint32_t i = 0; i < threads; ++i) bi[i].pass = (p); runThreads(m, boruvkaThreaded, bi, sizeof(BoruvkaInfo), threads); } while (0)
 
-    if (m->createFlags & mcfMultipleSolves) {
-        if (m->needsNeighborCountRefreshed)
-            memcpy(m->neighborCount, m->neighborCountCopy, sizeof(uint8_t) * m->totalPositions);
-        else
-            memcpy(m->neighborCountCopy, m->neighborCount, sizeof(uint8_t) * m->totalPositions);
-    } else if (m->needsNeighborCountRefreshed) {
-        fprintf(stderr, "Error: Maze_solve cannot be called more than once without setting mcfMultipleSolve in Maze_create\n");
-        return;
+    BORUVKA_PASS(bpInitialize);
+
+    MazeIndex knockedOutWalls = 0;
+    while (knockedOutWalls < m->totalPositions - 1) {
+        BORUVKA_PASS(bpFindLightest);
+        BORUVKA_PASS(bpSelect);
+        BORUVKA_PASS(bpUnion);
+        for (uint32_t i = 0; i < threads; ++i)
+            knockedOutWalls += bi[i].knockedOutWalls;
+        if (knockedOutWalls < m->totalPositions - 1)
+            BORUVKA_PASS(bpReset);
     }
 
-    m->start = start;
-    m->end = end;
+#undef BORUVKA_PASS
 
-    if (m->cores > 1) {
-        // For a parallel solve, we want the list of walls sorted, so when it gets distributed among threads,
-        // each thread gets to work on a contiguous section of the maze across all of its dimensions.
-        // The fastest way I can think of to get the list of walls sorted in-place is simply to read (in
-        // sorted order) from the halls[] bit arrays that the Maze_generate() function creates, and use that
-        // to re-write the beginning of the lottery[] array (up to knockedOutWalls), causing them to all be
+    collectKnockedOutWalls(m, bi, threads);
+
+    m->needsNeighborCountRefreshed = false;
+    m->needsLotteryRefreshed = false;
+
+    freeArray(m, lightest, sizeof(uint64_t) * m->totalPositions);
+    free(bi);
+    deleteKnockedOut(m, knockedOut);
+    return true;
+}
+
+// Tiles hold about this many cells, so a tile's lottery and sets stay in a core's L2 cache while it is generated
+#define TILED_TARGET_CELLS 16384
+
+typedef struct _TiledInfo {
+    MazeRef m;
+    BitArrayRef *knockedOut;
+    uint64_t seed;
+    const uint32_t *tileDims; // the size of a whole tile in each dimension (tiles at the far edges may be smaller)
+    const uint32_t *tileCounts; // the number of tiles along each dimension
+    MazeIndex totalTiles;
+    MazeIndex *nextTile; // shared by every thread, each claiming the next tile that nobody has generated yet
+} TiledInfo;
+
+static void *tiledThreaded(void *arg) {
+    TiledInfo *ti = (TiledInfo*)arg;
+    MazeRef m = ti->m;
+
+    MazeIndex maxTileCells = 1;
+    for (uint32_t d = 0; d < m->dims_length; ++d)
+        maxTileCells *= ti->tileDims[d];
+    Wall *lottery = (Wall*)malloc(sizeof(Wall) * maxTileCells * m->dims_length);
+    DisjSetsRef sets = DisjSets_create(maxTileCells);
+    MazeIndex *positions = (MazeIndex*)malloc(sizeof(MazeIndex) * maxTileCells); // where each cell of the tile is in the maze
+    MazeIndex *tilePlaceValues = (MazeIndex*)malloc(sizeof(MazeIndex) * m->dims_length);
+    uint32_t *origin = (uint32_t*)malloc(sizeof(uint32_t) * m->dims_length * 3);
+    uint32_t *extent = origin + m->dims_length;
+    uint32_t *coords = extent + m->dims_length;
+
+    MazeIndex tile;
+    while ((tile = __atomic_fetch_add(ti->nextTile, 1, __ATOMIC_RELAXED)) < ti->totalTiles) {
+        MazeIndex tileCells = 1;
+        MazeIndex rest = tile;
+        for (uint32_t d = 0; d < m->dims_length; ++d) {
+            origin[d] = (uint32_t)(rest % ti->tileCounts[d]) * ti->tileDims[d];
+            rest /= ti->tileCounts[d];
+            extent[d] = (m->dims[d] - origin[d] < ti->tileDims[d]) ? m->dims[d] - origin[d] : ti->tileDims[d];
+            coords[d] = 0;
+            tilePlaceValues[d] = tileCells;
+            tileCells *= extent[d];
+        }
+
+        // Walls inside the tile are packed with the cell's index within the tile, rather than within the maze
+        MazeIndex lotteryExtent = 0;
+        for (MazeIndex cell = 0; cell < tileCells; ++cell) {
+            MazeIndex position = 0;
+            for (uint32_t d = 0; d < m->dims_length; ++d) {
+                position += (origin[d] + coords[d]) * m->placeValues[d];
+                if (coords[d] < extent[d] - 1)
+                    lottery[lotteryExtent++] = Maze_packWall(m, cell, d);
+            }
+            positions[cell] = position;
+            for (uint32_t d = 0; d < m->dims_length; ++d) { // advance to the coordinates of the next cell
+                if (++coords[d] < extent[d])
+                    break;
+                coords[d] = 0;
+            }
+        }
+
+        // Randomized Kruskal's algorithm, seeded by the tile alone, so the maze doesn't depend on which thread
+        // generated which tile
+        Random random;
+        Random_seed(&random, ti->seed ^ mix64(tile));
+        DisjSets_reset(sets, tileCells);
+        MazeIndex knockedOutWalls = 0;
+        while (knockedOutWalls < tileCells - 1) {
+            MazeIndex r = (MazeIndex)Random_bounded(&random, lotteryExtent);
+            Wall wall = lottery[r];
+            lottery[r] = lottery[--lotteryExtent];
+            MazeIndex cell1 = Maze_wallCell1(m, wall);
+            uint32_t dim = Maze_wallDim(m, wall);
+            DisjSetsIndex root1 = DisjSets_find(sets, cell1);
+            DisjSetsIndex root2 = DisjSets_find(sets, cell1 + tilePlaceValues[dim]);
+            if (root1 != root2) {
+                DisjSets_union(sets, root1, root2);
+                BitArray_setBitAtomic(ti->knockedOut[dim], positions[cell1]); // neighboring tiles may share a byte
+                knockedOutWalls++;
+            }
+        }
+    }
+
+    free(origin);
+    free(tilePlaceValues);
+    free(positions);
+    DisjSets_delete(sets);
+    free(lottery);
+    return 0;
+}
+
+// Splits the maze into tiles small enough to fit in cache, and generates a uniform spanning tree inside each of them
+// in parallel. The tiles are then joined by a random spanning tree of their own, knocking out one randomly chosen
+// wall between each pair of tiles it joins. Since exactly one hall ever crosses between two tiles, its mazes are
+// not uniform over the whole maze like the other algorithms' are, but it never touches more than a tile's worth of
+// memory at random.
+static bool generateTiled(MazeRef m) {
+    bool allocated = true;
+    BitArrayRef *knockedOut = m->halls;
+    if (!(m->createFlags & mcfOutputMaze)) {
+        knockedOut = (BitArrayRef*)malloc(sizeof(BitArrayRef) * m->dims_length);
+        for (uint32_t i = 0; i < m->dims_length; ++i) {
+            knockedOut[i] = createBitArray(m, m->totalPositions);
+            allocated = allocated && knockedOut[i];
+        }
+    }
+    if (!allocated) {
+        deleteKnockedOut(m, knockedOut);
+        return false;
+    }
+    for (uint32_t i = 0; i < m->dims_length; ++i)
+        BitArray_reset(knockedOut[i]);
+
+    // Keep halving the longest side of a tile until it is small enough
+    uint32_t *tileDims = (uint32_t*)malloc(sizeof(uint32_t) * m->dims_length * 2);
+    uint32_t *tileCounts = tileDims + m->dims_length;
+    memcpy(tileDims, m->dims, sizeof(uint32_t) * m->dims_length);
+    MazeIndex tileCells = m->totalPositions;
+    while (tileCells > TILED_TARGET_CELLS) {
+        uint32_t longest = 0;
+        for (uint32_t d = 1; d < m->dims_length; ++d)
+            if (tileDims[d] > tileDims[longest])
+                longest = d;
+        tileCells = tileCells / tileDims[longest] * ((tileDims[longest] + 1) / 2);
+        tileDims[longest] = (tileDims[longest] + 1) / 2;
+    }
+    MazeIndex totalTiles = 1;
+    for (uint32_t d = 0; d < m->dims_length; ++d) {
+        tileCounts[d] = (m->dims[d] + tileDims[d] - 1) / tileDims[d];
+        totalTiles *= tileCounts[d];
+    }
+
+    uint32_t threads = (totalTiles < m->cores) ? (uint32_t)totalTiles : m->cores;
+    TiledInfo *ti = (TiledInfo*)malloc(sizeof(TiledInfo) * threads);
+    uint64_t seed = Random_next(&m->random);
+    MazeIndex nextTile = 0;
+    for (uint32_t i = 0; i < threads; ++i) {
+        ti[i].m = m;
+        ti[i].knockedOut = knockedOut;
+        ti[i].seed = seed;
+        ti[i].tileDims = tileDims;
+        ti[i].tileCounts = tileCounts;
+        ti[i].totalTiles = totalTiles;
+        ti[i].nextTile = &nextTile;
+    }
+    runThreads(m, tiledThreaded, ti, sizeof(TiledInfo), threads);
+    free(ti);
+
+    // Join the tiles with randomized Kruskal's algorithm over a lottery of tiles, packed like walls between cells
+    Wall *lottery = (Wall*)malloc(sizeof(Wall) * totalTiles * m->dims_length);
+    MazeIndex *tilePlaceValues = (MazeIndex*)malloc(sizeof(MazeIndex) * m->dims_length);
+    uint32_t *coords = (uint32_t*)calloc(m->dims_length, sizeof(uint32_t));
+    MazeIndex lotteryExtent = 0;
+    MazeIndex placeValue = 1;
+    for (uint32_t d = 0; d < m->dims_length; ++d) {
+        tilePlaceValues[d] = placeValue;
+        placeValue *= tileCounts[d];
+    }
+    for (MazeIndex tile = 0; tile < totalTiles; ++tile) {
+        for (uint32_t d = 0; d < m->dims_length; ++d)
+            if (coords[d] < tileCounts[d] - 1)
+                lottery[lotteryExtent++] = Maze_packWall(m, tile, d);
+        for (uint32_t d = 0; d < m->dims_length; ++d) {
+            if (++coords[d] < tileCounts[d])
+                break;
+            coords[d] = 0;
+        }
+    }
+
+    DisjSetsRef tileSets = DisjSets_create(totalTiles);
+    MazeIndex joinedTiles = 1;
+    while (joinedTiles < totalTiles) {
+        MazeIndex r = (MazeIndex)Random_bounded(&m->random, lotteryExtent);
+        Wall wall = lottery[r];
+        lottery[r] = lottery[--lotteryExtent];
+        MazeIndex tile = Maze_wallCell1(m, wall);
+        uint32_t dim = Maze_wallDim(m, wall);
+        DisjSetsIndex root1 = DisjSets_find(tileSets, tile);
+        DisjSetsIndex root2 = DisjSets_find(tileSets, tile + tilePlaceValues[dim]);
+        if (root1 == root2)
+            continue;
+        DisjSets_union(tileSets, root1, root2);
+        joinedTiles++;
+
+        // Pick any cell on the tile's face that touches the other tile
+        MazeIndex position = 0;
+        MazeIndex rest = tile;
+        for (uint32_t d = 0; d < m->dims_length; ++d) {
+            uint32_t origin = (uint32_t)(rest % tileCounts[d]) * tileDims[d];
+            rest /= tileCounts[d];
+            uint32_t extent = (m->dims[d] - origin < tileDims[d]) ? m->dims[d] - origin : tileDims[d];
+            uint32_t coord = (d == dim) ? origin + extent - 1 : origin + (uint32_t)Random_bounded(&m->random, extent);
+            position += coord * m->placeValues[d];
+        }
+        BitArray_setBit(knockedOut[dim], position);
+    }
+    DisjSets_delete(tileSets);
+    free(coords);
+    free(tilePlaceValues);
+    free(lottery);
+    free(tileDims);
+
+    threads = (m->totalPositions < m->cores) ? 1 : m->cores;
+    BoruvkaInfo *bi = (BoruvkaInfo*)malloc(sizeof(BoruvkaInfo) * threads);
+    MazeIndex positionChunkSize = m->totalPositions / threads;
+    for (uint32_t i = 0; i < threads; ++i) {
+        bi[i].m = m;
+        bi[i].knockedOut = knockedOut;
+        bi[i].startPosition = i * positionChunkSize;
+        bi[i].endPosition = (i == threads - 1) ? m->totalPositions : (i + 1) * positionChunkSize;
+    }
+    collectKnockedOutWalls(m, bi, threads);
+    free(bi);
+
+    m->needsNeighborCountRefreshed = false;
+    m->needsLotteryRefreshed = false;
+    deleteKnockedOut(m, knockedOut);
+    return true;
+}
+
+bool Maze_generate(MazeRef m) {
+    if (!m)
+        return false;
+    discardTiles(m);
+    if (!m->totalPositions)
+        return true;
+
+    if (m->algorithm != maKruskal && !startThreadPool(m)) {
+        fprintf(stderr, "Error: Maze_generate could not start %u threads\n", m->cores);
+        return false;
+    }
+
+    if (m->seedUsed)
+        m->seed = Random_next(&m->random);
+    m->seedUsed = true;
+    Random_seed(&m->random, m->seed);
+
+    // Borůvka's algorithm sweeps through the lottery, but Kruskal's algorithm draws from all of it at random
+    adviseArray(m, m->lottery, sizeof(Wall) * m->totalWalls, (m->algorithm != maKruskal) ? aaSequential : aaRandom);
+
+    if (m->algorithm == maBoruvka) {
+        if (!generateBoruvka(m)) {
+            fprintf(stderr, "Error: Maze_generate could not allocate its working memory\n");
+            return false;
+        }
+        return true;
+    }
+
+    if (m->algorithm == maTiled) {
+        if (!generateTiled(m)) {
+            fprintf(stderr, "Error: Maze_generate could not allocate its working memory\n");
+            return false;
+        }
+        return true;
+    }
+
+    MazeIndex lotteryIndex = 0;
+    for (MazeIndex position = 0; position < m->totalPositions; ++position) {
+        MazeIndex placeValue = 1;
+        for (uint32_t i = 0; i < m->dims_length; ++i) {
+            uint32_t valueForThisDim = (position / placeValue) % m->dims[i];
+            if (valueForThisDim < m->dims[i] - 1) {
+                m->lottery[lotteryIndex] = Maze_packWall(m, position, i);
+                lotteryIndex++;
+            }
+            placeValue *= m->dims[i];
+        }
+    }
+
+    DisjSets_reset(m->sets, m->totalPositions);
+
+    MazeIndex lotteryExtent = m->totalWalls;
+    MazeIndex knockedOutWalls = 0;
+
+    if (m->createFlags & mcfOutputSolution) {
+        memset(m->neighborCount, 0, sizeof(uint8_t) * m->totalPositions);
+        m->needsNeighborCountRefreshed = false;
+        m->needsLotteryRefreshed = false;
+
+        while (knockedOutWalls < m->totalPositions - 1) {
+            MazeIndex r = (MazeIndex)Random_bounded(&m->random, lotteryExtent - knockedOutWalls) + knockedOutWalls;
+            MazeIndex cell1 = Maze_wallCell1(m, m->lottery[r]);
+            MazeIndex cell2 = Maze_wallCell2(m, m->lottery[r]);
+            DisjSetsIndex root1 = DisjSets_find(m->sets, cell1);
+            DisjSetsIndex root2 = DisjSets_find(m->sets, cell2);
+            if (root1 != root2) {
+                DisjSets_union(m->sets, root1, root2);
+                m->neighborCount[cell1]++;
+                m->neighborCount[cell2]++;
+                Wall tmp = m->lottery[knockedOutWalls];
+                m->lottery[knockedOutWalls] = m->lottery[r];
+                m->lottery[r] = tmp;
+                knockedOutWalls++;
+            } else {
+                m->lottery[r] = m->lottery[lotteryExtent - 1];
+                lotteryExtent--;
+            }
+        }
+    } else {
+        while (knockedOutWalls < m->totalPositions - 1) {
+            MazeIndex r = (MazeIndex)Random_bounded(&m->random, lotteryExtent - knockedOutWalls) + knockedOutWalls;
+            DisjSetsIndex root1 = DisjSets_find(m->sets, Maze_wallCell1(m, m->lottery[r]));
+            DisjSetsIndex root2 = DisjSets_find(m->sets, Maze_wallCell2(m, m->lottery[r]));
+            if (root1 != root2) {
+                DisjSets_union(m->sets, root1, root2);
+                Wall tmp = m->lottery[knockedOutWalls];
+                m->lottery[knockedOutWalls] = m->lottery[r];
+                m->lottery[r] = tmp;
+                knockedOutWalls++;
+            } else {
+                m->lottery[r] = m->lottery[lotteryExtent - 1];
+                lotteryExtent--;
+            }
+        }
+    }
+
+    if (m->createFlags & mcfOutputMaze) {
+        for (uint32_t i = 0; i < m->dims_length; ++i)
+            BitArray_reset(m->halls[i]);
+
+        for (MazeIndex i = 0; i < knockedOutWalls; ++i)
+            BitArray_setBit(m->halls[Maze_wallDim(m, m->lottery[i])], Maze_wallCell1(m, m->lottery[i]));
+    }
+    return true;
+}
+
+// Eller's algorithm only ever needs to remember which set each cell of the current row belongs to. Each row,
+// neighbors in different sets are joined at random, and then every set is continued down into the next row from
+// at least one of its cells. Cells that weren't continued down start new sets of their own in the next row, and
+// the last row joins every set that is left. Unlike Kruskal's algorithm, its mazes have a slight bias towards
+// long horizontal halls.
+typedef struct _EllerCoins {
+    Random random;
+    uint64_t bits;
+    uint32_t remaining;
+} EllerCoins;
+
+static inline bool Eller_flip(EllerCoins *coins) {
+    if (coins->remaining == 0) {
+        coins->bits = Random_next(&coins->random);
+        coins->remaining = 64;
+    }
+    coins->remaining--;
+    bool result = coins->bits & 1;
+    coins->bits >>= 1;
+    return result;
+}
+
+bool Maze_generateRows(uint32_t width, uint64_t height, uint64_t seed, MazeRowCallback callback, void *context) {
+    if (width == 0 || height == 0 || !callback)
+        return false;
+#ifndef MAZE_64BIT
+    if (width > INT32_MAX) // DisjSets stores its elements as int32_t
+        return false;
+#endif
+
+    DisjSetsIndex *label = (DisjSetsIndex*)malloc(sizeof(DisjSetsIndex) * width); // the set each cell of this row is in
+    uint32_t *count = (uint32_t*)malloc(sizeof(uint32_t) * width); // indexed by root: the cells of each set seen so far
+    uint32_t *pick = (uint32_t*)malloc(sizeof(uint32_t) * width); // indexed by root: the cell that continues down if no other does
+    uint8_t *flags = (uint8_t*)malloc(sizeof(uint8_t) * width); // indexed by root: whether the set continues down, and later whether a label is in use
+    DisjSetsRef sets = DisjSets_create(width);
+    BitArrayRef right = BitArray_create(width, true);
+    BitArrayRef down = BitArray_create(width, true);
+    bool ok = label && count && pick && flags && sets && right->data && down->data;
+
+    EllerCoins coins;
+    Random_seed(&coins.random, seed);
+    coins.remaining = 0;
+
+    for (uint32_t x = 0; ok && x < width; ++x)
+        label[x] = x;
+
+    for (uint64_t y = 0; ok && y < height; ++y) {
+        bool lastRow = (y == height - 1);
+        BitArray_reset(right);
+        BitArray_reset(down);
+        DisjSets_reset(sets, width);
+
+        for (uint32_t x = 0; x + 1 < width; ++x) {
+            DisjSetsIndex root1 = DisjSets_find(sets, label[x]);
+            DisjSetsIndex root2 = DisjSets_find(sets, label[x + 1]);
+            if (root1 != root2 && (lastRow || Eller_flip(&coins))) {
+                DisjSets_union(sets, root1, root2);
+                BitArray_setBit(right, x);
+            }
+        }
+
+        if (!lastRow) {
+            // No more unions happen in this row, so from here on each cell is labeled by its set's root
+            for (uint32_t x = 0; x < width; ++x) {
+                label[x] = DisjSets_find(sets, label[x]);
+                count[label[x]] = 0;
+                flags[label[x]] = false;
+            }
+            // Each cell continues down at random, while reservoir sampling picks one cell of each set uniformly,
+            // in case none of them did
+            for (uint32_t x = 0; x < width; ++x) {
+                if (Random_bounded(&coins.random, ++count[label[x]]) == 0)
+                    pick[label[x]] = x;
+                if (Eller_flip(&coins)) {
+                    BitArray_setBit(down, x);
+                    flags[label[x]] = true;
+                }
+            }
+            for (uint32_t x = 0; x < width; ++x) {
+                if (!flags[label[x]]) {
+                    BitArray_setBit(down, pick[label[x]]);
+                    flags[label[x]] = true;
+                }
+            }
+
+            // Cells below a hall stay in their set, and every other cell gets a label that no set uses
+            memset(flags, 0, sizeof(uint8_t) * width);
+            for (uint32_t x = 0; x < width; ++x)
+                if (BitArray_readBit(down, x))
+                    flags[label[x]] = true;
+            uint32_t unused = 0;
+            for (uint32_t x = 0; x < width; ++x) {
+                if (!BitArray_readBit(down, x)) {
+                    while (flags[unused])
+                        unused++;
+                    label[x] = unused;
+                    flags[unused] = true;
+                }
+            }
+        }
+
+        ok = callback(context, y, right, down);
+    }
+
+    BitArray_delete(down);
+    BitArray_delete(right);
+    DisjSets_delete(sets);
+    free(flags);
+    free(pick);
+    free(count);
+    free(label);
+    return ok;
+}
+
+typedef struct _DeadEndFillInfo {
+    MazeRef m;
+    MazeIndex startWall;
+    MazeIndex endWall;
+    MazeIndex knockedOutWalls;
+} DeadEndFillInfo;
+
+void *deadEndFillThreaded(void *arg) {
+    DeadEndFillInfo *defi = (DeadEndFillInfo*)arg;
+
+    MazeIndex knockedOutWalls = defi->endWall;
+    while (true) {
+        bool filledDeadEnd = false;
+        for (MazeIndex i = defi->startWall; i < knockedOutWalls; ++i) {
+            const MazeIndex cell1 = Maze_wallCell1(defi->m, defi->m->lottery[i]);
+            const MazeIndex cell2 = Maze_wallCell2(defi->m, defi->m->lottery[i]);
+            if ((defi->m->neighborCount[cell1] == 1 && cell1 != defi->m->start && cell1 != defi->m->end) || (defi->m->neighborCount[cell2] == 1 && cell2 != defi->m->start && cell2 != defi->m->end)) {
+                __atomic_fetch_sub(&defi->m->neighborCount[cell1], 1, __ATOMIC_SEQ_CST); // defi->m->neighborCount[cell1]--;
+                __atomic_fetch_sub(&defi->m->neighborCount[cell2], 1, __ATOMIC_SEQ_CST); // defi->m->neighborCount[cell2]--;
+                filledDeadEnd = true;
+                Wall tmp = defi->m->lottery[knockedOutWalls - 1]; // swap to the end of the knocked out wall part of the list
+                defi->m->lottery[knockedOutWalls - 1] = defi->m->lottery[i];
+                defi->m->lottery[i] = tmp;
+                knockedOutWalls--;
+            }
+        }
+        if (!filledDeadEnd)
+            break;
+    }
+    defi->knockedOutWalls = knockedOutWalls - defi->startWall;
+
+    return 0;
+}
+
+typedef struct _WorklistFillInfo {
+    MazeRef m;
+    MazeIndex startPosition;
+    MazeIndex endPosition;
+} WorklistFillInfo;
+
+// Finds the one neighbor of a cell that is connected to it and hasn't been filled in yet. Halls only
+// exist between cells that are adjacent, so no coordinates need to be computed to stay inside the maze.
+static inline MazeIndex unfilledNeighbor(MazeRef m, MazeIndex cell) {
+    MazeIndex placeValue = 1;
+    for (uint32_t d = 0; d < m->dims_length; ++d) {
+        if (BitArray_readBit(m->halls[d], cell) && __atomic_load_n(&m->neighborCount[cell + placeValue], __ATOMIC_RELAXED))
+            return cell + placeValue;
+        if (cell >= placeValue && BitArray_readBit(m->halls[d], cell - placeValue) && __atomic_load_n(&m->neighborCount[cell - placeValue], __ATOMIC_RELAXED))
+            return cell - placeValue;
+        placeValue *= m->dims[d];
+    }
+    return cell;
+}
+
+// Claims a dead end by dropping its neighbor count from 1 to 0, so exactly one thread fills each cell
+static inline bool claimDeadEnd(MazeRef m, MazeIndex cell) {
+    uint8_t expected = 1;
+    return cell != m->start && cell != m->end &&
+           __atomic_compare_exchange_n(&m->neighborCount[cell], &expected, 0, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+}
+
+void *worklistFillThreaded(void *arg) {
+    WorklistFillInfo *wfi = (WorklistFillInfo*)arg;
+    MazeRef m = wfi->m;
+
+    // Every dead end seeds a walk that fills in cells until it reaches a junction that still has other
+    // branches. Whichever walk removes the last of those branches continues on through the junction.
+    for (MazeIndex position = wfi->startPosition; position < wfi->endPosition; ++position) {
+        MazeIndex cell = position;
+        if (!claimDeadEnd(m, cell))
+            continue;
+        while (true) {
+            MazeIndex next = unfilledNeighbor(m, cell);
+            if (next == cell || __atomic_sub_fetch(&m->neighborCount[next], 1, __ATOMIC_ACQ_REL) != 1 || !claimDeadEnd(m, next))
+                break;
+            cell = next;
+        }
+    }
+
+    return 0;
+}
+
+static void solveWorklist(MazeRef m) {
+    uint32_t threads = (m->totalPositions < m->cores) ? 1 : m->cores;
+    WorklistFillInfo *wfi = (WorklistFillInfo*)malloc(sizeof(WorklistFillInfo) * threads);
+    MazeIndex chunkSize = m->totalPositions / threads;
+    for (uint32_t i = 0; i < threads; ++i) {
+        wfi[i].m = m;
+        wfi[i].startPosition = i * chunkSize;
+        wfi[i].endPosition = (i == threads - 1) ? m->totalPositions : (i + 1) * chunkSize;
+    }
+    runThreads(m, worklistFillThreaded, wfi, sizeof(WorklistFillInfo), threads);
+    free(wfi);
+
+    // Only the cells along the solution remain, so walk it from start to end
+    for (uint32_t i = 0; i < m->dims_length; ++i)
+        BitArray_reset(m->solution[i]);
+
+    MazeIndex solutionLength = 0;
+    MazeIndex previous = m->start;
+    MazeIndex cell = m->start;
+    while (cell != m->end) {
+        MazeIndex placeValue = 1;
+        MazeIndex next = cell;
+        for (uint32_t d = 0; d < m->dims_length && next == cell; ++d) {
+            if (BitArray_readBit(m->halls[d], cell) && cell + placeValue != previous && m->neighborCount[cell + placeValue]) {
+                next = cell + placeValue;
+                BitArray_setBit(m->solution[d], cell);
+            } else if (cell >= placeValue && BitArray_readBit(m->halls[d], cell - placeValue) && cell - placeValue != previous && m->neighborCount[cell - placeValue]) {
+                next = cell - placeValue;
+                BitArray_setBit(m->solution[d], next);
+            }
+            placeValue *= m->dims[d];
+        }
+        if (next == cell)
+            break;
+        previous = cell;
+        cell = next;
+        solutionLength++;
+    }
+    m->solutionLength = solutionLength;
+}
+
+// A loaded maze only has its halls, so the knocked out walls at the start of the lottery, and each cell's count of
+// neighbors, are rebuilt from them. Returns false if the halls don't join every cell, as a maze's always do.
+static bool refreshLottery(MazeRef m) {
+    memset(m->neighborCount, 0, sizeof(uint8_t) * m->totalPositions);
+    MazeIndex knockedOutWalls = 0;
+    for (uint32_t d = 0; d < m->dims_length; ++d) {
+        for (MazeIndex position = 0, end; BitArray_nextRun(m->halls[d], &position, &end, m->totalPositions, true); position = end) {
+            for (MazeIndex cell = position; cell < end; ++cell) {
+                if (knockedOutWalls == m->totalPositions - 1)
+                    return false;
+                m->lottery[knockedOutWalls++] = Maze_packWall(m, cell, d);
+                m->neighborCount[cell]++;
+                m->neighborCount[cell + m->placeValues[d]]++;
+            }
+        }
+    }
+    if (knockedOutWalls != m->totalPositions - 1)
+        return false;
+    m->needsLotteryRefreshed = false;
+    m->needsNeighborCountRefreshed = false;
+    return true;
+}
+
+bool Maze_solve(MazeRef m, MazeIndex start, MazeIndex end) {
+    if (!(m->createFlags & mcfOutputSolution)) {
+        fprintf(stderr, "Error: Maze_solve cannot be called without setting mcfOutputSolution in Maze_create\n");
+        return false;
+    }
+
+    if (!m || !m->lottery || !m->neighborCount)
+        return false;
+    Maze_loadAll(m);
+
+    if (!startThreadPool(m)) {
+        fprintf(stderr, "Error: Maze_solve could not start %u threads\n", m->cores);
+        return false;
+    }
+
+    if (m->needsLotteryRefreshed && !refreshLottery(m)) {
+        fprintf(stderr, "Error: Maze_solve cannot solve a maze whose halls don't form a spanning tree\n");
+        return false;
+    }
+
+    if (m->createFlags & mcfMultipleSolves) {
+        if (m->needsNeighborCountRefreshed)
+            memcpy(m->neighborCount, m->neighborCountCopy, sizeof(uint8_t) * m->totalPositions);
+        else
+            memcpy(m->neighborCountCopy, m->neighborCount, sizeof(uint8_t) * m->totalPositions);
+    } else if (m->needsNeighborCountRefreshed) {
+        fprintf(stderr, "Error: Maze_solve cannot be called more than once without setting mcfMultipleSolve in Maze_create\n");
+        return false;
+    }
+
+    m->start = start;
+    m->end = end;
+
+    if (m->solver == msWorklist && m->halls) {
+        solveWorklist(m);
+        m->needsNeighborCountRefreshed = true;
+        return true;
+    }
+
+    adviseArray(m, m->lottery, sizeof(Wall) * m->totalWalls, aaSequential);
+
+    if (m->cores > 1) {
+        // For a parallel solve, we want the list of walls sorted, so when it gets distributed among threads,
+        // each thread gets to work on a contiguous section of the maze across all of its dimensions.
+        // The fastest way I can think of to get the list of walls sorted in-place is simply to read (in
+        // sorted order) from the halls[] bit arrays that the Maze_generate() function creates, and use that
+        // to re-write the beginning of the lottery[] array (up to knockedOutWalls), causing them to all be
         // written in sorted order. This has the added benefit of not requiring any extra memory.
 
-        uint32_t knockedOutWallsIndex = 0;
-        for (uint32_t position = 0; position < m->totalPositions; ++position) {
-            uint32_t placeValue = 1;
+        // Walls on the far side of the maze are never knocked out, so there are no coordinates to check
+        MazeIndex knockedOutWallsIndex = 0;
+        for (MazeIndex position = 0; position < m->totalPositions; ++position) {
             for (uint32_t i = 0; i < m->dims_length; ++i) {
-                uint32_t valueForThisDim = (position / placeValue) % m->dims[i];
-                if (valueForThisDim < m->dims[i] - 1) {
-                    if (BitArray_readBit(m->halls[i], position)) {
-                        m->lottery[knockedOutWallsIndex].cell1 = position;
-                        m->lottery[knockedOutWallsIndex].cell2 = position + placeValue;
-                        knockedOutWallsIndex++;
-                    }
+                if (BitArray_readBit(m->halls[i], position)) {
+                    m->lottery[knockedOutWallsIndex] = Maze_packWall(m, position, i);
+                    knockedOutWallsIndex++;
                 }
-                placeValue *= m->dims[i];
             }
         }
 
         DeadEndFillInfo defi[m->cores];
-        uint32_t chunkSize = (m->totalPositions - 1) / m->cores; // ensure we don't rollover
+        MazeIndex chunkSize = (m->totalPositions - 1) / m->cores; // ensure we don't rollover
         for (uint32_t i = 0; i < m->cores; ++i) {
             defi[i].m = m;
             defi[i].startWall = i * chunkSize;
@@ -276,38 +1549,15 @@ void Maze_solve(MazeRef m, uint32_t start, uint32_t end) {
             defi[i].knockedOutWalls = 0;
         }
 
-#ifdef __cplusplus
-        std::thread t[m->cores];
-        for (uint32_t i = 0; i < m->cores; ++i)
-            t[i] = std::thread(deadEndFillThreaded, (void*)&defi[i]);
-        for (uint32_t i = 0; i < m->cores; ++i)
-            t[i].join();
-#else
-        pthread_t t[m->cores];
-        for (uint32_t i = 0; i < m->cores; ++i) {
-            int rc = pthread_create(&t[i], NULL, deadEndFillThreaded, (void*)&defi[i]);
-            if (rc) {
-                fprintf(stderr, "Error: pthread_create() returned code %d\n", rc);
-                exit(-1);
-            }
-        }
-        for (uint32_t i = 0; i < m->cores; ++i) {
-            void *status;
-            int rc = pthread_join(t[i], &status);
-            if (rc) {
-                fprintf(stderr, "Error: pthread_join() returned code %d\n", rc);
-                exit(-1);
-            }
-        }
-#endif
-        uint32_t knockedOutWalls = 0;
+        runThreads(m, deadEndFillThreaded, defi, sizeof(DeadEndFillInfo), m->cores);
+        MazeIndex knockedOutWalls = 0;
         for (uint32_t i = 0; i < m->cores; ++i)
             knockedOutWalls += defi[i].knockedOutWalls;
 
         // Reorder the lottery, so every sub-solution is joined at the beginning
-        uint32_t writeAt = defi[0].startWall + defi[0].knockedOutWalls;
+        MazeIndex writeAt = defi[0].startWall + defi[0].knockedOutWalls;
         for (uint32_t i = 1; i < m->cores; ++i) {
-            for (uint32_t j = 0; j < defi[i].knockedOutWalls; ++j) {
+            for (MazeIndex j = 0; j < defi[i].knockedOutWalls; ++j) {
                 Wall tmp = m->lottery[writeAt];
                 m->lottery[writeAt] = m->lottery[defi[i].startWall + j];
                 m->lottery[defi[i].startWall + j] = tmp;
@@ -324,12 +1574,12 @@ void Maze_solve(MazeRef m, uint32_t start, uint32_t end) {
         deadEndFillThreaded(&finalPass);
         m->solutionLength = knockedOutWalls - (knockedOutWalls - finalPass.knockedOutWalls);
     } else {
-        uint32_t knockedOutWalls = m->totalPositions - 1;
+        MazeIndex knockedOutWalls = m->totalPositions - 1;
         while (true) {
             bool filledDeadEnd = false;
-            for (uint32_t i = 0; i < knockedOutWalls; ++i) {
-                const uint32_t cell1 = m->lottery[i].cell1;
-                const uint32_t cell2 = m->lottery[i].cell2;
+            for (MazeIndex i = 0; i < knockedOutWalls; ++i) {
+                const MazeIndex cell1 = Maze_wallCell1(m, m->lottery[i]);
+                const MazeIndex cell2 = Maze_wallCell2(m, m->lottery[i]);
                 if ((m->neighborCount[cell1] == 1 && cell1 != start && cell1 != end) || (m->neighborCount[cell2] == 1 && cell2 != start && cell2 != end)) {
                     m->neighborCount[cell1]--;
                     m->neighborCount[cell2]--;
@@ -352,17 +1602,1466 @@ void Maze_solve(MazeRef m, uint32_t start, uint32_t end) {
         for (uint32_t i = 0; i < m->dims_length; ++i)
             BitArray_reset(m->solution[i]);
 
-        for (uint32_t i = 0; i < m->solutionLength; ++i) {
-            uint32_t placeValue = 1;
-            for (uint32_t d = 0; d < m->dims_length; ++d) {
-                if (m->dims[d] == 1)
-                    continue;
-                if (m->lottery[i].cell2 == m->lottery[i].cell1 + placeValue) {
-                    BitArray_setBit(m->solution[d], m->lottery[i].cell1);
-                    break;
-                }
-                placeValue *= m->dims[d];
-            }
-        }
+        for (MazeIndex i = 0; i < m->solutionLength; ++i)
+            BitArray_setBit(m->solution[Maze_wallDim(m, m->lottery[i])], Maze_wallCell1(m, m->lottery[i]));
+    }
+    return true;
+}
+
+// Every cell along the solution but its ends has exactly two walls marked in m->solution, so the next cell is the
+// one across whichever of them doesn't lead back to the previous cell
+static inline MazeIndex nextSolutionCell(MazeRef m, MazeIndex cell, MazeIndex previous) {
+    MazeIndex placeValue = 1;
+    for (uint32_t d = 0; d < m->dims_length; ++d) {
+        if (BitArray_readBit(m->solution[d], cell) && cell + placeValue != previous)
+            return cell + placeValue;
+        if (cell >= placeValue && BitArray_readBit(m->solution[d], cell - placeValue) && cell - placeValue != previous)
+            return cell - placeValue;
+        placeValue *= m->dims[d];
+    }
+    return cell;
+}
+
+bool Maze_walkSolution(MazeRef m, MazeCellCallback callback, void *context) {
+    if (!m || !m->solution || !callback)
+        return false;
+    Maze_loadAll(m);
+    MazeIndex previous = m->start;
+    MazeIndex cell = m->start;
+    if (!callback(context, cell))
+        return false;
+    for (MazeIndex i = 0; i < m->solutionLength; ++i) {
+        MazeIndex next = nextSolutionCell(m, cell, previous);
+        if (next == cell)
+            return false;
+        previous = cell;
+        cell = next;
+        if (!callback(context, cell))
+            return false;
     }
+    return true;
+}
+
+typedef struct _SolutionPathInfo {
+    MazeIndex *cells;
+    MazeIndex length;
+} SolutionPathInfo;
+
+static bool appendSolutionCell(void *context, MazeIndex cell) {
+    SolutionPathInfo *spi = (SolutionPathInfo*)context;
+    spi->cells[spi->length++] = cell;
+    return true;
+}
+
+MazeIndex Maze_solutionPath(MazeRef m, MazeIndex *cells) {
+    SolutionPathInfo spi = { cells, 0 };
+    Maze_walkSolution(m, appendSolutionCell, &spi);
+    return spi.length;
+}
+
+// The walls of a .maze file are numbered cell by cell, and within a cell by dimension, skipping the dimensions a
+// cell is on the far side of. Along a row of dims[0] cells, the dimensions above the first are either all present
+// or all absent for every cell, so a whole row is just the bits of halls[0] interleaved with the bits of each of
+// the other dimensions present on that row (with no halls[0] bit for the row's last cell). That makes rows cheap
+// to transcode in bulk: a straight copy when no other dimension is present, or a bit interleave when one is (every
+// row of a 2D maze but its last).
+
+// Spreads the low 32 bits of x out into the even bits of the result, and back again
+#ifdef __BMI2__
+static inline uint64_t spreadBits(uint64_t x) {
+    return _pdep_u64(x, 0x5555555555555555ULL);
+}
+
+static inline uint64_t compactBits(uint64_t x) {
+    return _pext_u64(x, 0x5555555555555555ULL);
+}
+#else
+static inline uint64_t spreadBits(uint64_t x) {
+    x = (x | (x << 16)) & 0x0000FFFF0000FFFFULL;
+    x = (x | (x << 8)) & 0x00FF00FF00FF00FFULL;
+    x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    x = (x | (x << 2)) & 0x3333333333333333ULL;
+    return (x | (x << 1)) & 0x5555555555555555ULL;
+}
+
+static inline uint64_t compactBits(uint64_t x) {
+    x &= 0x5555555555555555ULL;
+    x = (x | (x >> 1)) & 0x3333333333333333ULL;
+    x = (x | (x >> 2)) & 0x0F0F0F0F0F0F0F0FULL;
+    x = (x | (x >> 4)) & 0x00FF00FF00FF00FFULL;
+    x = (x | (x >> 8)) & 0x0000FFFF0000FFFFULL;
+    return (x | (x >> 16)) & 0x00000000FFFFFFFFULL;
+}
+#endif
+
+// The walls of a .maze file, which are read or written in order starting at any bit, a byte at a time
+typedef struct _WallStream {
+    uint8_t *walls;
+    uint64_t byte; // the next byte to read or write
+    uint64_t bits; // bits read but not yet returned, or written but not yet stored, lowest first
+    uint32_t count;
+    bool shared; // whether the next byte written may also hold another thread's bits
+} WallStream;
+
+static inline void WallStream_start(WallStream *ws, uint8_t *walls, uint64_t bit, bool writing) {
+    ws->walls = walls;
+    ws->byte = bit / 8;
+    ws->bits = 0;
+    ws->count = 0;
+    ws->shared = (bit % 8) != 0;
+    if (writing)
+        ws->count = bit % 8; // as zeros, which leave the other thread's bits in the first byte alone
+    else if (bit % 8) {
+        ws->bits = ws->walls[ws->byte++] >> (bit % 8);
+        ws->count = 8 - bit % 8;
+    }
+}
+
+// Returns the next count (up to 56) bits
+static inline uint64_t WallStream_read(WallStream *ws, uint32_t count) {
+    while (ws->count < count) {
+        ws->bits |= (uint64_t)ws->walls[ws->byte++] << ws->count;
+        ws->count += 8;
+    }
+    uint64_t bits = ws->bits & (((uint64_t)1 << count) - 1);
+    ws->bits >>= count;
+    ws->count -= count;
+    return bits;
+}
+
+static inline void WallStream_storeByte(WallStream *ws, uint8_t byte) {
+    if (ws->shared) {
+        __atomic_fetch_or(&ws->walls[ws->byte], byte, __ATOMIC_RELAXED);
+        ws->shared = false;
+    } else {
+        ws->walls[ws->byte] = byte;
+    }
+    ws->byte++;
+}
+
+// Writes the lowest count (up to 56) bits of bits, which must be the only ones set
+static inline void WallStream_write(WallStream *ws, uint64_t bits, uint32_t count) {
+    ws->bits |= bits << ws->count;
+    ws->count += count;
+    while (ws->count >= 8) {
+        WallStream_storeByte(ws, (uint8_t)ws->bits);
+        ws->bits >>= 8;
+        ws->count -= 8;
+    }
+}
+
+// Stores a partly written last byte, which the next thread may also be writing to
+static inline void WallStream_finish(WallStream *ws) {
+    if (ws->count) {
+        ws->shared = true;
+        WallStream_storeByte(ws, (uint8_t)ws->bits);
+    }
+}
+
+// The number of walls in a .maze file that belong to cells before position
+static MazeIndex wallsBefore(MazeRef m, MazeIndex position) {
+    MazeIndex walls = 0;
+    for (uint32_t d = 0; d < m->dims_length; ++d) {
+        MazeIndex block = m->placeValues[d] * m->dims[d];
+        MazeIndex rest = position % block;
+        MazeIndex farSide = (position / block) * m->placeValues[d]; // cells before position with no wall in this dimension
+        if (rest > m->placeValues[d] * (m->dims[d] - 1))
+            farSide += rest - m->placeValues[d] * (m->dims[d] - 1);
+        walls += position - farSide;
+    }
+    return walls;
+}
+
+// Threads transcode whole multiples of 64 rows, so no two of them ever write to the same word of a BitArray
+#define TRANSCODE_ROWS_PER_CHUNK 64
+#define TRANSCODE_RUN 28 // bits of each dimension interleaved at a time, which must fit twice into WallStream_write()
+
+typedef struct _TranscodeInfo {
+    MazeRef m;
+    BitArrayRef *halls;
+    uint8_t *walls;
+    bool encode;
+    MazeIndex firstRow;
+    MazeIndex endRow;
+} TranscodeInfo;
+
+static void *transcodeThreaded(void *arg) {
+    TranscodeInfo *ti = (TranscodeInfo*)arg;
+    MazeRef m = ti->m;
+    MazeIndex width = m->dims[0];
+    BitArrayRef *halls = ti->halls;
+
+    uint32_t *coords = (uint32_t*)malloc(sizeof(uint32_t) * m->dims_length * 2);
+    uint32_t *present = coords + m->dims_length; // the dimensions above the first that this row has walls in
+    for (uint32_t d = 1; d < m->dims_length; ++d)
+        coords[d] = (uint32_t)((ti->firstRow * width / m->placeValues[d]) % m->dims[d]);
+
+    WallStream ws;
+    WallStream_start(&ws, ti->walls, wallsBefore(m, ti->firstRow * width), ti->encode);
+    for (MazeIndex row = ti->firstRow; row < ti->endRow; ++row) {
+        MazeIndex rowStart = row * width;
+        uint32_t presentCount = 0;
+        for (uint32_t d = 1; d < m->dims_length; ++d)
+            if (coords[d] < m->dims[d] - 1)
+                present[presentCount++] = d;
+
+        if (presentCount == 0) {
+            for (MazeIndex x = 0; x < width - 1; x += TRANSCODE_RUN) {
+                uint32_t run = (width - 1 - x < TRANSCODE_RUN) ? (uint32_t)(width - 1 - x) : TRANSCODE_RUN;
+                if (ti->encode)
+                    WallStream_write(&ws, BitArray_readBits(halls[0], rowStart + x, run), run);
+                else
+                    BitArray_orBits(halls[0], rowStart + x, WallStream_read(&ws, run), run);
+            }
+        } else if (presentCount == 1) {
+            BitArrayRef other = halls[present[0]];
+            for (MazeIndex x = 0; x < width - 1; x += TRANSCODE_RUN) {
+                uint32_t run = (width - 1 - x < TRANSCODE_RUN) ? (uint32_t)(width - 1 - x) : TRANSCODE_RUN;
+                if (ti->encode) {
+                    uint64_t bits = spreadBits(BitArray_readBits(halls[0], rowStart + x, run)) | (spreadBits(BitArray_readBits(other, rowStart + x, run)) << 1);
+                    WallStream_write(&ws, bits, run * 2);
+                } else {
+                    uint64_t bits = WallStream_read(&ws, run * 2);
+                    BitArray_orBits(halls[0], rowStart + x, compactBits(bits), run);
+                    BitArray_orBits(other, rowStart + x, compactBits(bits >> 1), run);
+                }
+            }
+            if (ti->encode)
+                WallStream_write(&ws, BitArray_readBit(other, rowStart + width - 1), 1);
+            else if (WallStream_read(&ws, 1))
+                BitArray_setBit(other, rowStart + width - 1);
+        } else {
+            for (MazeIndex x = 0; x < width; ++x) {
+                for (uint32_t i = (x < width - 1) ? 0 : 1; i <= presentCount; ++i) {
+                    BitArrayRef ba = halls[i ? present[i - 1] : 0];
+                    if (ti->encode)
+                        WallStream_write(&ws, BitArray_readBit(ba, rowStart + x), 1);
+                    else if (WallStream_read(&ws, 1))
+                        BitArray_setBit(ba, rowStart + x);
+                }
+            }
+        }
+
+        for (uint32_t d = 1; d < m->dims_length; ++d) { // advance to the coordinates of the next row
+            if (++coords[d] < m->dims[d])
+                break;
+            coords[d] = 0;
+        }
+    }
+    if (ti->encode)
+        WallStream_finish(&ws);
+
+    free(coords);
+    return 0;
+}
+
+static void transcodeWalls(MazeRef m, BitArrayRef *halls, uint8_t *walls, bool encode) {
+    if (!m->totalPositions)
+        return;
+    MazeIndex rows = m->totalPositions / m->dims[0];
+    MazeIndex chunks = rows / TRANSCODE_ROWS_PER_CHUNK + ((rows % TRANSCODE_ROWS_PER_CHUNK) ? 1 : 0);
+    uint32_t threads = (chunks < m->cores) ? (uint32_t)chunks : m->cores;
+    if (threads > 1 && !startThreadPool(m))
+        threads = 1;
+
+    TranscodeInfo *ti = (TranscodeInfo*)malloc(sizeof(TranscodeInfo) * threads);
+    for (uint32_t i = 0; i < threads; ++i) {
+        ti[i].m = m;
+        ti[i].halls = halls;
+        ti[i].walls = walls;
+        ti[i].encode = encode;
+        ti[i].firstRow = chunks * i / threads * TRANSCODE_ROWS_PER_CHUNK;
+        ti[i].endRow = (i == threads - 1) ? rows : chunks * (i + 1) / threads * TRANSCODE_ROWS_PER_CHUNK;
+    }
+    runThreads(m, transcodeThreaded, ti, sizeof(TranscodeInfo), threads);
+    free(ti);
+}
+
+void Maze_encodeWalls(MazeRef m, BitArrayRef *src, uint8_t *dst) {
+    memset(dst, 0, m->totalWalls / 8 + ((m->totalWalls % 8) ? 1 : 0));
+    transcodeWalls(m, src, dst, true);
+}
+
+void Maze_decodeWalls(MazeRef m, const uint8_t *src, BitArrayRef *dst) {
+    for (uint32_t i = 0; i < m->dims_length; ++i)
+        BitArray_reset(dst[i]);
+    transcodeWalls(m, dst, (uint8_t*)src, false);
+}
+
+static inline uint64_t alignFileOffset(uint64_t offset) {
+    return (offset + MAZE_FILE_ALIGNMENT - 1) & ~(uint64_t)(MAZE_FILE_ALIGNMENT - 1);
+}
+
+static inline bool isBigEndian(void) {
+    const uint16_t probe = 1;
+    return *(const uint8_t*)&probe == 0;
+}
+
+static inline void storeLittleEndian(uint8_t *bytes, uint64_t value, size_t size) {
+    for (size_t i = 0; i < size; ++i)
+        bytes[i] = (uint8_t)(value >> (8 * i));
+}
+
+static inline uint64_t loadLittleEndian(const uint8_t *bytes, size_t size) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; ++i)
+        value |= (uint64_t)bytes[i] << (8 * i);
+    return value;
+}
+
+// Returns UINT64_MAX if the size of the file could not be found
+static uint64_t fileLength(FILE *file) {
+#ifdef _WIN32
+    if (_fseeki64(file, 0, SEEK_END) != 0)
+        return UINT64_MAX;
+    __int64 length = _ftelli64(file);
+    return length < 0 ? UINT64_MAX : (uint64_t)length;
+#else
+    struct stat st;
+    return fstat(fileno(file), &st) == 0 ? (uint64_t)st.st_size : UINT64_MAX;
+#endif
+}
+
+static bool seekFile(FILE *file, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(file, (__int64)offset, SEEK_SET) == 0;
+#else
+    return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+// The bytes each of halls[] and solution[] take up in a version 2 file, including the padding after them
+static inline uint64_t bitmapFileBytes(MazeRef m) {
+    return alignFileOffset(sizeof(uint64_t) * BitArray_wordCount(m->totalPositions));
+}
+
+// Fills in the header of a version 2 file, and the dims that follow it
+static void storeFileHeader(MazeRef m, uint8_t *header, uint32_t flags) {
+    memcpy(header, "MAZE", 4);
+    storeLittleEndian(header + 4, MAZE_FILE_VERSION, sizeof(uint32_t));
+    storeLittleEndian(header + 8, flags, sizeof(uint32_t));
+    storeLittleEndian(header + 12, m->dims_length, sizeof(uint32_t));
+    storeLittleEndian(header + 16, m->solutionLength, sizeof(uint64_t));
+    storeLittleEndian(header + 24, m->start, sizeof(uint64_t));
+    storeLittleEndian(header + 32, m->end, sizeof(uint64_t));
+    for (uint32_t i = 0; i < m->dims_length; ++i)
+        storeLittleEndian(header + MAZE_FILE_HEADER_BYTES + sizeof(uint32_t) * i, m->dims[i], sizeof(uint32_t));
+}
+
+bool Maze_save(MazeRef m, const char *fileName) {
+    if (!m || !m->halls) {
+        fprintf(stderr, "Error: Maze_save cannot be called without setting mcfOutputMaze in Maze_create\n");
+        return false;
+    }
+    Maze_loadAll(m);
+    FILE *file = fopen(fileName, "wb");
+    if (!file) {
+        fprintf(stderr, "Error: Maze_save could not create '%s': %s\n", fileName, strerror(errno));
+        return false;
+    }
+
+    uint64_t headerBytes = alignFileOffset(MAZE_FILE_HEADER_BYTES + sizeof(uint32_t) * m->dims_length);
+    uint8_t *header = (uint8_t*)calloc(headerBytes, 1);
+    storeFileHeader(m, header, (m->solution ? mffSolution : 0) | (isBigEndian() ? mffBigEndian : 0));
+    bool ok = fwrite(header, 1, headerBytes, file) == headerBytes;
+    free(header);
+
+    static const uint8_t padding[MAZE_FILE_ALIGNMENT] = {0};
+    size_t bytes = sizeof(uint64_t) * BitArray_wordCount(m->totalPositions);
+    size_t paddingBytes = (size_t)(bitmapFileBytes(m) - bytes);
+    uint32_t bitmaps = m->solution ? 2 * m->dims_length : m->dims_length;
+    for (uint32_t i = 0; ok && i < bitmaps; ++i) {
+        BitArrayRef ba = (i < m->dims_length) ? m->halls[i] : m->solution[i - m->dims_length];
+        ok = fwrite(ba->data, 1, bytes, file) == bytes && fwrite(padding, 1, paddingBytes, file) == paddingBytes;
+    }
+
+    if (fclose(file) != 0)
+        ok = false;
+    if (!ok)
+        fprintf(stderr, "Error: Maze_save could not write '%s'\n", fileName);
+    return ok;
+}
+
+bool Maze_saveSeed(MazeRef m, const char *fileName) {
+    if (!m || !m->seedUsed) {
+        fprintf(stderr, "Error: Maze_saveSeed cannot be called unless the maze came from Maze_generate with its current seed\n");
+        return false;
+    }
+    FILE *file = fopen(fileName, "wb");
+    if (!file) {
+        fprintf(stderr, "Error: Maze_saveSeed could not create '%s': %s\n", fileName, strerror(errno));
+        return false;
+    }
+
+    size_t bytes = MAZE_FILE_HEADER_BYTES + sizeof(uint32_t) * m->dims_length + MAZE_FILE_SEED_BYTES;
+    uint8_t *header = (uint8_t*)calloc(bytes, 1);
+    storeFileHeader(m, header, mffSeedOnly | ((m->solution && m->solutionLength) ? mffSolution : 0));
+    uint8_t *seed = header + bytes - MAZE_FILE_SEED_BYTES;
+    storeLittleEndian(seed, m->algorithm, sizeof(uint32_t));
+    storeLittleEndian(seed + 8, m->seed, sizeof(uint64_t));
+    bool ok = fwrite(header, 1, bytes, file) == bytes;
+    free(header);
+
+    if (fclose(file) != 0)
+        ok = false;
+    if (!ok)
+        fprintf(stderr, "Error: Maze_saveSeed could not write '%s'\n", fileName);
+    return ok;
+}
+
+// Compressed files code each wall with an adaptive binary range coder (the one LZMA uses), whose probability for
+// a wall is chosen by the halls already coded around it, and code a solution hall only where there is a hall, by
+// how many halls of the solution the cell is already known to have. Rows are coded in blocks that are each
+// independent of the others, so they can be coded on every core.
+#define CODER_PROBABILITY_BITS 11
+#define CODER_MOVE_BITS 5
+#define CODER_BLOCK_CELLS (1 << 20) // roughly how many cells each block holds
+#define CODER_DIM_CONTEXTS 8 // dimensions past this share the probabilities of the last one
+#define CODER_HALL_CONTEXTS (CODER_DIM_CONTEXTS * 16 * 3)
+#define CODER_SOLUTION_CONTEXTS (CODER_DIM_CONTEXTS * 3)
+
+typedef struct _RangeCoder {
+    bool encoding;
+    uint8_t *data;
+    uint64_t length; // the bytes written so far, or when decoding, the next byte to read
+    uint64_t capacity; // the bytes allocated, or when decoding, the end of data
+    uint64_t low;
+    uint32_t range;
+    uint32_t code;
+    uint8_t cache; // the last byte of low that a carry could still change, and how many bytes of 0xFF follow it
+    uint64_t cacheSize;
+    bool failed; // the encoder ran out of memory
+} RangeCoder;
+
+static void RangeCoder_putByte(RangeCoder *rc, uint8_t byte) {
+    if (rc->length == rc->capacity) {
+        uint64_t capacity = rc->capacity ? rc->capacity * 2 : 4096;
+        uint8_t *data = (uint8_t*)realloc(rc->data, capacity);
+        if (!data) {
+            rc->failed = true;
+            return;
+        }
+        rc->data = data;
+        rc->capacity = capacity;
+    }
+    rc->data[rc->length++] = byte;
+}
+
+static void RangeCoder_shiftLow(RangeCoder *rc) {
+    if ((uint32_t)rc->low < 0xFF000000u || (rc->low >> 32) != 0) {
+        uint8_t carry = (uint8_t)(rc->low >> 32);
+        uint8_t byte = rc->cache;
+        do {
+            RangeCoder_putByte(rc, (uint8_t)(byte + carry));
+            byte = 0xFF;
+        } while (--rc->cacheSize != 0);
+        rc->cache = (uint8_t)(rc->low >> 24);
+    }
+    rc->cacheSize++;
+    rc->low = (rc->low & 0x00FFFFFF) << 8;
+}
+
+// Reads zeros past the end of the data, so a damaged file decodes to a wrong maze rather than reading past it
+static inline uint8_t RangeCoder_getByte(RangeCoder *rc) {
+    return (rc->length < rc->capacity) ? rc->data[rc->length++] : 0;
+}
+
+static void RangeCoder_startEncoding(RangeCoder *rc) {
+    memset(rc, 0, sizeof(RangeCoder));
+    rc->encoding = true;
+    rc->range = 0xFFFFFFFF;
+    rc->cacheSize = 1;
+}
+
+static void RangeCoder_finishEncoding(RangeCoder *rc) {
+    for (int i = 0; i < 5; ++i)
+        RangeCoder_shiftLow(rc);
+}
+
+// Decodes rc->capacity bytes of rc->data
+static void RangeCoder_startDecoding(RangeCoder *rc) {
+    rc->encoding = false;
+    rc->length = 0;
+    rc->range = 0xFFFFFFFF;
+    rc->code = 0;
+    for (int i = 0; i < 5; ++i)
+        rc->code = (rc->code << 8) | RangeCoder_getByte(rc);
+}
+
+// Encodes bit, or ignores it and decodes the next one, and returns it either way
+static inline bool RangeCoder_bit(RangeCoder *rc, uint16_t *probability, bool bit) {
+    uint32_t bound = (rc->range >> CODER_PROBABILITY_BITS) * *probability;
+    if (rc->encoding ? !bit : rc->code < bound) {
+        rc->range = bound;
+        *probability += ((1 << CODER_PROBABILITY_BITS) - *probability) >> CODER_MOVE_BITS;
+        bit = false;
+    } else {
+        if (rc->encoding)
+            rc->low += bound;
+        else
+            rc->code -= bound;
+        rc->range -= bound;
+        *probability -= *probability >> CODER_MOVE_BITS;
+        bit = true;
+    }
+    while (rc->range < (1u << 24)) {
+        rc->range <<= 8;
+        if (rc->encoding)
+            RangeCoder_shiftLow(rc);
+        else
+            rc->code = (rc->code << 8) | RangeCoder_getByte(rc);
+    }
+    return bit;
+}
+
+// Whole rows of about CODER_BLOCK_CELLS cells, which also make up whole words of each bit array, so threads never
+// decode into the same word
+static uint64_t coderRowsPerBlock(MazeRef m) {
+    uint64_t step = BITARRAY_WORD_BITS;
+    for (uint32_t width = m->dims[0]; step > 1 && !(width & 1); width >>= 1)
+        step >>= 1;
+    uint64_t rows = CODER_BLOCK_CELLS / m->dims[0];
+    if (!rows)
+        rows = 1;
+    return (rows + step - 1) / step * step;
+}
+
+typedef struct _CoderInfo {
+    MazeRef m;
+    bool encoding;
+    bool solution; // whether solution[] is coded as well as halls[]
+    bool atomic; // whether other threads may be decoding into the same words of halls[] and solution[] at once
+    uint64_t rowsPerBlock;
+    uint64_t blockCount;
+    RangeCoder *blocks;
+    uint64_t *nextBlock; // shared by every thread, each claiming the next block that nobody has coded yet
+    const uint32_t *tileDims; // for tiled files, the size of a whole tile in each dimension, or NULL
+    const uint32_t *tileCounts; // the number of tiles along each dimension
+} CoderInfo;
+
+static void resetProbabilities(uint16_t *probabilities) {
+    for (uint32_t i = 0; i < CODER_HALL_CONTEXTS + CODER_SOLUTION_CONTEXTS; ++i)
+        probabilities[i] = 1 << (CODER_PROBABILITY_BITS - 1);
+}
+
+static inline void setCodedBit(CoderInfo *ci, BitArrayRef ba, MazeIndex cell) {
+    if (ci->atomic)
+        BitArray_setBitAtomic(ba, cell);
+    else
+        BitArray_setBit(ba, cell);
+}
+
+static inline bool readCodedBit(CoderInfo *ci, BitArrayRef ba, MazeIndex cell) {
+    return ci->atomic ? BitArray_readBitAtomic(ba, cell) : BitArray_readBit(ba, cell);
+}
+
+// Codes the walls of a cell at coords, and its solution, where before[d] says whether the cell before it in
+// dimension d has been coded already. Decoding expects halls[] and solution[] to be all zeros.
+static inline void codeCell(CoderInfo *ci, RangeCoder *rc, MazeIndex cell, const uint32_t *coords, const bool *before, uint16_t *probabilities) {
+    MazeRef m = ci->m;
+    uint16_t *hallProbabilities = probabilities;
+    uint16_t *solutionProbabilities = probabilities + CODER_HALL_CONTEXTS;
+
+    // The halls into this cell from the cells before it in the first two dimensions, and how many of its halls
+    // from the cells before it in any dimension are on the solution, as far as has been coded
+    uint32_t into = 0;
+    uint32_t solutionHalls = 0;
+    for (uint32_t d = 0; d < m->dims_length; ++d) {
+        if (!before[d])
+            continue;
+        MazeIndex neighbor = cell - m->placeValues[d];
+        if (d < 2 && readCodedBit(ci, m->halls[d], neighbor))
+            into |= 1u << d;
+        if (ci->solution && readCodedBit(ci, m->solution[d], neighbor))
+            solutionHalls++;
+    }
+
+    uint32_t hallsOut = 0;
+    for (uint32_t d = 0; d < m->dims_length; ++d) {
+        if (coords[d] == m->dims[d] - 1)
+            continue; // a wall on the far edge of the maze, which is never knocked out
+        uint32_t dim = (d < CODER_DIM_CONTEXTS) ? d : CODER_DIM_CONTEXTS - 1;
+        uint32_t same = 0; // whether the cells before this one in the first two dimensions have this hall
+        if (before[0] && readCodedBit(ci, m->halls[d], cell - 1))
+            same |= 1;
+        if (m->dims_length > 1 && before[1] && readCodedBit(ci, m->halls[d], cell - m->placeValues[1]))
+            same |= 2;
+        uint32_t context = ((dim * 4 + into) * 4 + same) * 3 + ((hallsOut < 2) ? hallsOut : 2);
+        if (!RangeCoder_bit(rc, &hallProbabilities[context], ci->encoding && BitArray_readBit(m->halls[d], cell)))
+            continue;
+        hallsOut++;
+        if (!ci->encoding)
+            setCodedBit(ci, m->halls[d], cell);
+
+        if (!ci->solution)
+            continue;
+        context = dim * 3 + ((solutionHalls < 2) ? solutionHalls : 2);
+        if (RangeCoder_bit(rc, &solutionProbabilities[context], ci->encoding && BitArray_readBit(m->solution[d], cell))) {
+            solutionHalls++;
+            if (!ci->encoding)
+                setCodedBit(ci, m->solution[d], cell);
+        }
+    }
+}
+
+// The cells from firstCell up to endCell, which are whole rows
+static void codeBlock(CoderInfo *ci, RangeCoder *rc, MazeIndex firstCell, MazeIndex endCell, uint32_t *coords, bool *before, uint16_t *probabilities) {
+    MazeRef m = ci->m;
+    resetProbabilities(probabilities);
+
+    MazeIndex rest = firstCell;
+    for (uint32_t d = 0; d < m->dims_length; ++d) {
+        coords[d] = (uint32_t)(rest % m->dims[d]);
+        rest /= m->dims[d];
+    }
+
+    for (MazeIndex cell = firstCell; cell < endCell; ++cell) {
+        for (uint32_t d = 0; d < m->dims_length; ++d)
+            before[d] = coords[d] && cell - m->placeValues[d] >= firstCell;
+        codeCell(ci, rc, cell, coords, before, probabilities);
+        for (uint32_t d = 0; d < m->dims_length && ++coords[d] == m->dims[d]; ++d)
+            coords[d] = 0;
+    }
+}
+
+static void *coderThreaded(void *arg) {
+    CoderInfo *ci = (CoderInfo*)arg;
+    MazeRef m = ci->m;
+    uint32_t *coords = (uint32_t*)malloc(sizeof(uint32_t) * m->dims_length);
+    bool *before = (bool*)malloc(sizeof(bool) * m->dims_length);
+    uint16_t *probabilities = (uint16_t*)malloc(sizeof(uint16_t) * (CODER_HALL_CONTEXTS + CODER_SOLUTION_CONTEXTS));
+    MazeIndex rows = m->totalPositions / m->dims[0];
+
+    uint64_t block;
+    while ((block = __atomic_fetch_add(ci->nextBlock, 1, __ATOMIC_RELAXED)) < ci->blockCount) {
+        MazeIndex firstRow = (MazeIndex)(block * ci->rowsPerBlock);
+        MazeIndex endRow = (rows - firstRow < ci->rowsPerBlock) ? rows : (MazeIndex)(firstRow + ci->rowsPerBlock);
+        RangeCoder *rc = &ci->blocks[block];
+        if (ci->encoding)
+            RangeCoder_startEncoding(rc);
+        else
+            RangeCoder_startDecoding(rc);
+        codeBlock(ci, rc, firstRow * m->dims[0], endRow * m->dims[0], coords, before, probabilities);
+        if (ci->encoding)
+            RangeCoder_finishEncoding(rc);
+    }
+
+    free(probabilities);
+    free(before);
+    free(coords);
+    return NULL;
+}
+
+// Codes every block of blocks on m->cores, or on one core if the blocks share words of the bit arrays
+static void codeBlocks(MazeRef m, RangeCoder *blocks, uint64_t rowsPerBlock, uint64_t blockCount, bool encoding, bool solution) {
+    uint32_t threads = (blockCount < m->cores) ? (uint32_t)blockCount : m->cores;
+    if (((uint64_t)m->dims[0] * rowsPerBlock) % BITARRAY_WORD_BITS != 0 || (threads > 1 && !startThreadPool(m)))
+        threads = 1;
+    if (!threads)
+        return;
+
+    CoderInfo *ci = (CoderInfo*)malloc(sizeof(CoderInfo) * threads);
+    uint64_t nextBlock = 0;
+    for (uint32_t i = 0; i < threads; ++i) {
+        ci[i].m = m;
+        ci[i].encoding = encoding;
+        ci[i].solution = solution;
+        ci[i].atomic = false;
+        ci[i].tileDims = ci[i].tileCounts = NULL;
+        ci[i].rowsPerBlock = rowsPerBlock;
+        ci[i].blockCount = blockCount;
+        ci[i].blocks = blocks;
+        ci[i].nextBlock = &nextBlock;
+    }
+    runThreads(m, coderThreaded, ci, sizeof(CoderInfo), threads);
+    free(ci);
+}
+
+bool Maze_saveCompressed(MazeRef m, const char *fileName) {
+    if (!m || !m->halls) {
+        fprintf(stderr, "Error: Maze_saveCompressed cannot be called without setting mcfOutputMaze in Maze_create\n");
+        return false;
+    }
+    Maze_loadAll(m);
+
+    MazeIndex rows = m->totalPositions ? m->totalPositions / m->dims[0] : 0;
+    uint64_t rowsPerBlock = m->totalPositions ? coderRowsPerBlock(m) : 1;
+    uint64_t blockCount = rows / rowsPerBlock + ((rows % rowsPerBlock) ? 1 : 0);
+    RangeCoder *blocks = (RangeCoder*)calloc(blockCount ? blockCount : 1, sizeof(RangeCoder));
+    codeBlocks(m, blocks, rowsPerBlock, blockCount, true, m->solution != NULL);
+    bool ok = true;
+    for (uint64_t i = 0; i < blockCount; ++i)
+        ok = ok && !blocks[i].failed;
+    if (!ok)
+        fprintf(stderr, "Error: Maze_saveCompressed could not allocate its working memory\n");
+
+    FILE *file = NULL;
+    if (ok && !(file = fopen(fileName, "wb"))) {
+        fprintf(stderr, "Error: Maze_saveCompressed could not create '%s': %s\n", fileName, strerror(errno));
+        ok = false;
+    }
+    if (ok) {
+        size_t indexOffset = MAZE_FILE_HEADER_BYTES + sizeof(uint32_t) * m->dims_length;
+        size_t headerBytes = indexOffset + sizeof(uint64_t) * (2 + blockCount);
+        uint8_t *header = (uint8_t*)calloc(headerBytes, 1);
+        storeFileHeader(m, header, mffCompressed | (m->solution ? mffSolution : 0));
+        storeLittleEndian(header + indexOffset, rowsPerBlock, sizeof(uint64_t));
+        storeLittleEndian(header + indexOffset + sizeof(uint64_t), blockCount, sizeof(uint64_t));
+        for (uint64_t i = 0; i < blockCount; ++i)
+            storeLittleEndian(header + indexOffset + sizeof(uint64_t) * (2 + i), blocks[i].length, sizeof(uint64_t));
+        ok = fwrite(header, 1, headerBytes, file) == headerBytes;
+        free(header);
+        for (uint64_t i = 0; ok && i < blockCount; ++i)
+            ok = fwrite(blocks[i].data, 1, blocks[i].length, file) == blocks[i].length;
+        if (fclose(file) != 0)
+            ok = false;
+        if (!ok)
+            fprintf(stderr, "Error: Maze_saveCompressed could not write '%s'\n", fileName);
+    }
+
+    for (uint64_t i = 0; i < blockCount; ++i)
+        free(blocks[i].data);
+    free(blocks);
+    return ok;
+}
+
+#define CODER_TILE_CELLS 65536 // roughly how many cells each tile of a tiled file holds
+
+static MazeIndex countTiles(MazeRef m, const uint32_t *tileDims, uint32_t *tileCounts) {
+    MazeIndex totalTiles = 1;
+    for (uint32_t d = 0; d < m->dims_length; ++d) {
+        tileCounts[d] = m->dims[d] / tileDims[d] + ((m->dims[d] % tileDims[d]) ? 1 : 0);
+        totalTiles *= tileCounts[d];
+    }
+    return totalTiles;
+}
+
+// Halves the longest side of a tile until it holds no more than CODER_TILE_CELLS cells, and returns the number
+// of tiles
+static MazeIndex chooseTiles(MazeRef m, uint32_t *tileDims, uint32_t *tileCounts) {
+    memcpy(tileDims, m->dims, sizeof(uint32_t) * m->dims_length);
+    uint64_t tileCells = m->totalPositions;
+    while (tileCells > CODER_TILE_CELLS) {
+        uint32_t longest = 0;
+        for (uint32_t d = 1; d < m->dims_length; ++d)
+            if (tileDims[d] > tileDims[longest])
+                longest = d;
+        tileCells = tileCells / tileDims[longest] * ((tileDims[longest] + 1) / 2);
+        tileDims[longest] = (tileDims[longest] + 1) / 2;
+    }
+    return countTiles(m, tileDims, tileCounts);
+}
+
+// The cells of a tile, in the same order as the cells of the maze. Only the cells before each cell inside the same
+// tile count as coded already, so a tile never needs another one to be decoded first.
+static void codeTile(CoderInfo *ci, RangeCoder *rc, MazeIndex tile, uint32_t *scratch, bool *before, uint16_t *probabilities) {
+    MazeRef m = ci->m;
+    uint32_t *origin = scratch;
+    uint32_t *tileEnd = origin + m->dims_length;
+    uint32_t *coords = tileEnd + m->dims_length;
+    resetProbabilities(probabilities);
+
+    MazeIndex cell = 0;
+    MazeIndex rest = tile;
+    for (uint32_t d = 0; d < m->dims_length; ++d) {
+        origin[d] = (uint32_t)(rest % ci->tileCounts[d]) * ci->tileDims[d];
+        rest /= ci->tileCounts[d];
+        tileEnd[d] = (m->dims[d] - origin[d] < ci->tileDims[d]) ? m->dims[d] : origin[d] + ci->tileDims[d];
+        coords[d] = origin[d];
+        cell += origin[d] * m->placeValues[d];
+    }
+
+    while (true) {
+        for (uint32_t d = 0; d < m->dims_length; ++d)
+            before[d] = coords[d] > origin[d];
+        codeCell(ci, rc, cell, coords, before, probabilities);
+
+        uint32_t d = 0;
+        for (; d < m->dims_length; ++d) {
+            if (++coords[d] < tileEnd[d]) {
+                cell += m->placeValues[d];
+                break;
+            }
+            cell -= (MazeIndex)(coords[d] - 1 - origin[d]) * m->placeValues[d];
+            coords[d] = origin[d];
+        }
+        if (d == m->dims_length)
+            return;
+    }
+}
+
+static inline uint64_t tileOffset(MazeTiles *tiles, MazeIndex tile) {
+    return loadLittleEndian(tiles->file + tiles->indexOffset + sizeof(uint64_t) * tile, sizeof(uint64_t));
+}
+
+// Decodes a tile of a lazily loaded maze, unless another thread already has
+static void decodeTile(CoderInfo *ci, MazeIndex tile, uint32_t *scratch, bool *before, uint16_t *probabilities) {
+    MazeTiles *tiles = ci->m->tiles;
+    uint8_t expected = tsLeft;
+    if (!__atomic_compare_exchange_n(&tiles->states[tile], &expected, (uint8_t)tsDecoding, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        return;
+
+    RangeCoder rc;
+    memset(&rc, 0, sizeof(RangeCoder));
+    uint64_t first = tileOffset(tiles, tile);
+    rc.data = tiles->file + first;
+    rc.capacity = tileOffset(tiles, tile + 1) - first;
+    RangeCoder_startDecoding(&rc);
+    codeTile(ci, &rc, tile, scratch, before, probabilities);
+
+    __atomic_store_n(&tiles->states[tile], (uint8_t)tsDecoded, __ATOMIC_RELEASE);
+    __atomic_fetch_sub(&tiles->tilesLeft, 1, __ATOMIC_RELEASE);
+}
+
+static void startTileCoder(CoderInfo *ci, MazeRef m, bool encoding, bool solution, const uint32_t *tileDims, const uint32_t *tileCounts) {
+    memset(ci, 0, sizeof(CoderInfo));
+    ci->m = m;
+    ci->encoding = encoding;
+    ci->solution = solution;
+    ci->atomic = !encoding; // tiles share words of halls[] and solution[] with their neighbors
+    ci->tileDims = tileDims;
+    ci->tileCounts = tileCounts;
+}
+
+static void *tileCoderThreaded(void *arg) {
+    CoderInfo *ci = (CoderInfo*)arg;
+    MazeRef m = ci->m;
+    uint32_t *scratch = (uint32_t*)malloc(sizeof(uint32_t) * m->dims_length * 3);
+    bool *before = (bool*)malloc(sizeof(bool) * m->dims_length);
+    uint16_t *probabilities = (uint16_t*)malloc(sizeof(uint16_t) * (CODER_HALL_CONTEXTS + CODER_SOLUTION_CONTEXTS));
+
+    uint64_t tile;
+    while ((tile = __atomic_fetch_add(ci->nextBlock, 1, __ATOMIC_RELAXED)) < ci->blockCount) {
+        if (ci->encoding) {
+            RangeCoder_startEncoding(&ci->blocks[tile]);
+            codeTile(ci, &ci->blocks[tile], (MazeIndex)tile, scratch, before, probabilities);
+            RangeCoder_finishEncoding(&ci->blocks[tile]);
+        } else {
+            decodeTile(ci, (MazeIndex)tile, scratch, before, probabilities);
+        }
+    }
+
+    free(probabilities);
+    free(before);
+    free(scratch);
+    return NULL;
+}
+
+// Encodes every tile into blocks, or decodes every tile of a lazily loaded maze that nobody has decoded yet, on
+// m->cores
+static void codeTiles(MazeRef m, CoderInfo *shared, RangeCoder *blocks, MazeIndex totalTiles) {
+    uint32_t threads = (totalTiles < m->cores) ? (uint32_t)totalTiles : m->cores;
+    if (threads > 1 && !startThreadPool(m))
+        threads = 1;
+    if (!threads)
+        return;
+
+    CoderInfo *ci = (CoderInfo*)malloc(sizeof(CoderInfo) * threads);
+    uint64_t nextTile = 0;
+    for (uint32_t i = 0; i < threads; ++i) {
+        ci[i] = *shared;
+        ci[i].blocks = blocks;
+        ci[i].blockCount = totalTiles;
+        ci[i].nextBlock = &nextTile;
+    }
+    runThreads(m, tileCoderThreaded, ci, sizeof(CoderInfo), threads);
+    free(ci);
+}
+
+void Maze_loadRegion(MazeRef m, const uint32_t *first, const uint32_t *end) {
+    MazeTiles *tiles = m->tiles;
+    if (!tiles || !__atomic_load_n(&tiles->tilesLeft, __ATOMIC_ACQUIRE))
+        return;
+
+    uint32_t *firstTile = (uint32_t*)malloc(sizeof(uint32_t) * m->dims_length * 6);
+    uint32_t *lastTile = firstTile + m->dims_length;
+    uint32_t *coords = lastTile + m->dims_length;
+    uint32_t *scratch = coords + m->dims_length;
+    bool *before = (bool*)malloc(sizeof(bool) * m->dims_length);
+    uint16_t *probabilities = (uint16_t*)malloc(sizeof(uint16_t) * (CODER_HALL_CONTEXTS + CODER_SOLUTION_CONTEXTS));
+    bool empty = false;
+    for (uint32_t d = 0; d < m->dims_length; ++d) {
+        uint32_t last = ((end[d] < m->dims[d]) ? end[d] : m->dims[d]);
+        empty = empty || first[d] >= last;
+        firstTile[d] = empty ? 0 : first[d] / tiles->tileDims[d];
+        lastTile[d] = empty ? 0 : (last - 1) / tiles->tileDims[d];
+    }
+    CoderInfo ci;
+    startTileCoder(&ci, m, false, tiles->solution, tiles->tileDims, tiles->tileCounts);
+
+    // Decode whichever tiles nobody else is decoding first, and only then wait for the ones they are
+    for (int pass = 0; !empty && pass < 2; ++pass) {
+        memcpy(coords, firstTile, sizeof(uint32_t) * m->dims_length);
+        uint32_t d;
+        do {
+            MazeIndex tile = 0;
+            for (uint32_t i = m->dims_length; i-- > 0;)
+                tile = tile * tiles->tileCounts[i] + coords[i];
+            if (pass == 0)
+                decodeTile(&ci, tile, scratch, before, probabilities);
+            else
+                waitForTile(tiles, tile);
+            for (d = 0; d < m->dims_length && ++coords[d] > lastTile[d]; ++d)
+                coords[d] = firstTile[d];
+        } while (d < m->dims_length);
+    }
+
+    free(probabilities);
+    free(before);
+    free(firstTile);
+}
+
+void Maze_loadAll(MazeRef m) {
+    MazeTiles *tiles = m->tiles;
+    if (!tiles || !__atomic_load_n(&tiles->tilesLeft, __ATOMIC_ACQUIRE))
+        return;
+    CoderInfo ci;
+    startTileCoder(&ci, m, false, tiles->solution, tiles->tileDims, tiles->tileCounts);
+    codeTiles(m, &ci, NULL, tiles->totalTiles);
+
+    // Maze_loadRegion() may still be decoding some of them on other threads
+    while (__atomic_load_n(&tiles->tilesLeft, __ATOMIC_ACQUIRE))
+        yieldThread();
+}
+
+bool Maze_saveTiled(MazeRef m, const char *fileName) {
+    if (!m || !m->halls) {
+        fprintf(stderr, "Error: Maze_saveTiled cannot be called without setting mcfOutputMaze in Maze_create\n");
+        return false;
+    }
+    Maze_loadAll(m);
+
+    uint32_t *tileDims = (uint32_t*)malloc(sizeof(uint32_t) * m->dims_length * 2);
+    uint32_t *tileCounts = tileDims + m->dims_length;
+    MazeIndex totalTiles = m->totalPositions ? chooseTiles(m, tileDims, tileCounts) : 0;
+    RangeCoder *blocks = (RangeCoder*)calloc(totalTiles ? totalTiles : 1, sizeof(RangeCoder));
+    CoderInfo ci;
+    startTileCoder(&ci, m, true, m->solution != NULL, tileDims, tileCounts);
+    codeTiles(m, &ci, blocks, totalTiles);
+    bool ok = true;
+    for (MazeIndex i = 0; i < totalTiles; ++i)
+        ok = ok && !blocks[i].failed;
+    if (!ok)
+        fprintf(stderr, "Error: Maze_saveTiled could not allocate its working memory\n");
+
+    FILE *file = NULL;
+    if (ok && !(file = fopen(fileName, "wb"))) {
+        fprintf(stderr, "Error: Maze_saveTiled could not create '%s': %s\n", fileName, strerror(errno));
+        ok = false;
+    }
+    if (ok) {
+        size_t tileDimsOffset = MAZE_FILE_HEADER_BYTES + sizeof(uint32_t) * m->dims_length;
+        size_t indexOffset = tileDimsOffset + sizeof(uint32_t) * m->dims_length;
+        size_t headerBytes = indexOffset + sizeof(uint64_t) * ((size_t)totalTiles + 1);
+        uint8_t *header = (uint8_t*)calloc(headerBytes, 1);
+        storeFileHeader(m, header, mffCompressed | mffTiled | (m->solution ? mffSolution : 0));
+        for (uint32_t d = 0; d < m->dims_length; ++d)
+            storeLittleEndian(header + tileDimsOffset + sizeof(uint32_t) * d, tileDims[d], sizeof(uint32_t));
+        uint64_t offset = headerBytes;
+        for (MazeIndex i = 0; i <= totalTiles; ++i) {
+            storeLittleEndian(header + indexOffset + sizeof(uint64_t) * i, offset, sizeof(uint64_t));
+            offset += (i < totalTiles) ? blocks[i].length : 0;
+        }
+        ok = fwrite(header, 1, headerBytes, file) == headerBytes;
+        free(header);
+        for (MazeIndex i = 0; ok && i < totalTiles; ++i)
+            ok = fwrite(blocks[i].data, 1, blocks[i].length, file) == blocks[i].length;
+        if (fclose(file) != 0)
+            ok = false;
+        if (!ok)
+            fprintf(stderr, "Error: Maze_saveTiled could not write '%s'\n", fileName);
+    }
+
+    for (MazeIndex i = 0; i < totalTiles; ++i)
+        free(blocks[i].data);
+    free(blocks);
+    free(tileDims);
+    return ok;
+}
+
+// Returns NULL if the dimensions at offset don't fit in the file, or any of them is zero
+static uint32_t *readDims(FILE *file, uint64_t length, uint64_t offset, uint32_t dims_length) {
+    if (dims_length == 0 || length < offset + sizeof(uint32_t) * (uint64_t)dims_length)
+        return NULL;
+    uint32_t *dims = (uint32_t*)malloc(sizeof(uint32_t) * dims_length);
+    for (uint32_t i = 0; i < dims_length; ++i) {
+        uint8_t bytes[sizeof(uint32_t)];
+        if (fread(bytes, sizeof(uint32_t), 1, file) != 1 || (dims[i] = (uint32_t)loadLittleEndian(bytes, sizeof(uint32_t))) == 0) {
+            free(dims);
+            return NULL;
+        }
+    }
+    return dims;
+}
+
+static void invalidFile(const char *fileName) {
+    fprintf(stderr, "Error: Maze_load found that '%s' is not a valid maze\n", fileName);
+}
+
+static MazeRef loadVersion1(FILE *file, uint64_t length, const char *fileName, uint32_t cores) {
+    uint8_t bytes[sizeof(uint64_t)];
+    if (length < sizeof(uint32_t) || fread(bytes, sizeof(uint32_t), 1, file) != 1) {
+        invalidFile(fileName);
+        return NULL;
+    }
+    uint32_t dims_length = (uint32_t)loadLittleEndian(bytes, sizeof(uint32_t));
+    uint32_t *dims = readDims(file, length, sizeof(uint32_t), dims_length);
+    if (!dims) {
+        invalidFile(fileName);
+        return NULL;
+    }
+    MazeRef m = Maze_create(dims, dims_length, (MazeCreateFlags)(mcfOutputMaze | mcfOutputSolution));
+    free(dims);
+    if (!m)
+        return NULL;
+    Maze_setCores(m, cores);
+
+    size_t solutionLengthBytes = Maze_solutionLengthBytes(m->totalPositions);
+    uint64_t data_length = m->totalWalls / 8 + ((m->totalWalls % 8) ? 1 : 0); // bytes of walls, for both the maze and the solution
+    uint8_t *walls = NULL;
+    bool ok = length >= sizeof(uint32_t) * ((uint64_t)dims_length + 1) + solutionLengthBytes + data_length * 2;
+    ok = ok && (walls = (uint8_t*)malloc(data_length ? data_length : 1)) != NULL;
+    ok = ok && fread(walls, 1, data_length, file) == data_length;
+    if (ok)
+        Maze_decodeWalls(m, walls, m->halls);
+    ok = ok && fread(bytes, solutionLengthBytes, 1, file) == 1;
+    if (ok)
+        m->solutionLength = (MazeIndex)loadLittleEndian(bytes, solutionLengthBytes);
+    m->end = m->totalPositions - 1; // version 1 files don't store where the solution runs, but it always ran to the last cell
+    ok = ok && fread(walls, 1, data_length, file) == data_length;
+    if (ok)
+        Maze_decodeWalls(m, walls, m->solution);
+    free(walls);
+
+    if (!ok) {
+        invalidFile(fileName);
+        Maze_delete(m);
+        return NULL;
+    }
+    m->needsLotteryRefreshed = true;
+    return m;
+}
+
+// Returns true if a bit is set for any cell on the far side of dimension d, where there's no neighbor for it to join
+static bool hasFarEdgeBits(MazeRef m, BitArrayRef ba, uint32_t d) {
+    MazeIndex placeValue = m->placeValues[d];
+    MazeIndex span = placeValue * m->dims[d];
+    for (MazeIndex block = 0; block < m->totalPositions; block += span)
+        if (BitArray_findNextSet(ba, block + span - placeValue, block + span) != block + span)
+            return true;
+    return false;
+}
+
+static MazeRef loadSeedOnly(FILE *file, uint64_t length, const char *fileName, uint32_t cores, uint32_t *dims, uint32_t dims_length, bool solve, uint64_t start, uint64_t end) {
+    uint8_t bytes[MAZE_FILE_SEED_BYTES];
+    if (length < MAZE_FILE_HEADER_BYTES + sizeof(uint32_t) * (uint64_t)dims_length + MAZE_FILE_SEED_BYTES || fread(bytes, MAZE_FILE_SEED_BYTES, 1, file) != 1) {
+        invalidFile(fileName);
+        return NULL;
+    }
+    uint32_t algorithm = (uint32_t)loadLittleEndian(bytes, sizeof(uint32_t));
+    if (algorithm > maTiled) {
+        fprintf(stderr, "Error: Maze_load cannot generate '%s' with algorithm %u\n", fileName, algorithm);
+        return NULL;
+    }
+    MazeRef m = Maze_create(dims, dims_length, (MazeCreateFlags)(mcfOutputMaze | mcfOutputSolution));
+    if (!m)
+        return NULL;
+    if (start >= m->totalPositions || end >= m->totalPositions) {
+        invalidFile(fileName);
+        Maze_delete(m);
+        return NULL;
+    }
+
+    // Borůvka's algorithm and the tiled generator make the same maze from a seed on any number of cores
+    Maze_setCores(m, cores);
+    Maze_setAlgorithm(m, (MazeAlgorithm)algorithm);
+    Maze_setSolver(m, msWorklist);
+    Maze_setSeed(m, loadLittleEndian(bytes + 8, sizeof(uint64_t)));
+    if (!Maze_generate(m) || (solve && !Maze_solve(m, (MazeIndex)start, (MazeIndex)end))) {
+        Maze_delete(m);
+        return NULL;
+    }
+    m->needsLotteryRefreshed = solve; // so it can be solved again, like a maze loaded from any other file
+    return m;
+}
+
+static MazeRef loadCompressed(FILE *file, uint64_t length, const char *fileName, uint32_t cores, uint32_t *dims, uint32_t dims_length, bool solution, uint64_t solutionLength, uint64_t start, uint64_t end) {
+    uint64_t indexOffset = MAZE_FILE_HEADER_BYTES + sizeof(uint32_t) * (uint64_t)dims_length;
+    uint8_t bytes[2 * sizeof(uint64_t)];
+    if (length < indexOffset + sizeof(bytes) || fread(bytes, sizeof(bytes), 1, file) != 1) {
+        invalidFile(fileName);
+        return NULL;
+    }
+    uint64_t rowsPerBlock = loadLittleEndian(bytes, sizeof(uint64_t));
+    uint64_t blockCount = loadLittleEndian(bytes + sizeof(uint64_t), sizeof(uint64_t));
+    MazeRef m = Maze_create(dims, dims_length, (MazeCreateFlags)(mcfOutputMaze | mcfOutputSolution));
+    if (!m)
+        return NULL;
+    Maze_setCores(m, cores);
+
+    MazeIndex rows = m->totalPositions / m->dims[0];
+    bool ok = rowsPerBlock && blockCount == rows / rowsPerBlock + ((rows % rowsPerBlock) ? 1 : 0) &&
+              (length - indexOffset - sizeof(bytes)) / sizeof(uint64_t) >= blockCount &&
+              solutionLength <= m->totalPositions && start < m->totalPositions && end < m->totalPositions;
+
+    // Every block is read in before any is decoded; they hold a few bits per cell at most
+    RangeCoder *blocks = ok ? (RangeCoder*)calloc(blockCount ? blockCount : 1, sizeof(RangeCoder)) : NULL;
+    uint64_t remaining = ok ? length - indexOffset - sizeof(bytes) - sizeof(uint64_t) * blockCount : 0;
+    for (uint64_t i = 0; ok && i < blockCount; ++i) {
+        ok = fread(bytes, sizeof(uint64_t), 1, file) == 1;
+        blocks[i].capacity = loadLittleEndian(bytes, sizeof(uint64_t));
+        ok = ok && blocks[i].capacity <= remaining;
+        remaining -= ok ? blocks[i].capacity : 0;
+    }
+    for (uint64_t i = 0; ok && i < blockCount; ++i) {
+        blocks[i].data = (uint8_t*)malloc(blocks[i].capacity ? blocks[i].capacity : 1);
+        ok = blocks[i].data && fread(blocks[i].data, 1, blocks[i].capacity, file) == blocks[i].capacity;
+    }
+
+    if (ok) {
+        for (uint32_t d = 0; d < m->dims_length; ++d) {
+            BitArray_reset(m->halls[d]);
+            BitArray_reset(m->solution[d]);
+        }
+        codeBlocks(m, blocks, rowsPerBlock, blockCount, false, solution);
+        m->solutionLength = (MazeIndex)solutionLength;
+        m->start = (MazeIndex)start;
+        m->end = (MazeIndex)end;
+    }
+
+    if (blocks) {
+        for (uint64_t i = 0; i < blockCount; ++i)
+            free(blocks[i].data);
+        free(blocks);
+    }
+    if (!ok) {
+        invalidFile(fileName);
+        Maze_delete(m);
+        return NULL;
+    }
+    m->needsLotteryRefreshed = true;
+    return m;
+}
+
+static MazeRef loadTiled(FILE *file, uint64_t length, const char *fileName, uint32_t cores, uint32_t *dims, uint32_t dims_length, bool solution, uint64_t solutionLength, uint64_t start, uint64_t end, bool lazily) {
+    MazeRef m = createMaze(dims, dims_length, (MazeCreateFlags)(mcfOutputMaze | mcfOutputSolution), NULL, false);
+    if (!m)
+        return NULL;
+    Maze_setCores(m, cores);
+
+    // Tiles are decoded into bits that start as zeros, which calloc() gets from the system without touching them,
+    // so a huge maze costs no memory until its tiles are decoded
+    bool ok = true;
+    for (uint32_t i = 0; ok && i < 2 * dims_length; ++i) {
+        BitArrayRef ba = (i < dims_length) ? m->halls[i] : m->solution[i - dims_length];
+        ba->data = (uint64_t*)calloc(ba->data_length ? ba->data_length : 1, sizeof(uint64_t));
+        ok = ba->data != NULL;
+    }
+    if (!ok) {
+        fprintf(stderr, "Error: Maze_load could not allocate the memory for '%s'\n", fileName);
+        Maze_delete(m);
+        return NULL;
+    }
+
+    MazeTiles *tiles = (MazeTiles*)calloc(1, sizeof(MazeTiles));
+    m->tiles = tiles;
+    tiles->tileDims = (uint32_t*)malloc(sizeof(uint32_t) * dims_length * 2);
+    tiles->tileCounts = tiles->tileDims + dims_length;
+    tiles->solution = solution;
+    for (uint32_t d = 0; ok && d < dims_length; ++d) {
+        uint8_t bytes[sizeof(uint32_t)];
+        ok = fread(bytes, sizeof(uint32_t), 1, file) == 1 && (tiles->tileDims[d] = (uint32_t)loadLittleEndian(bytes, sizeof(uint32_t))) != 0;
+    }
+    if (ok) {
+        tiles->totalTiles = countTiles(m, tiles->tileDims, tiles->tileCounts);
+        tiles->indexOffset = MAZE_FILE_HEADER_BYTES + sizeof(uint32_t) * (uint64_t)dims_length * 2;
+        ok = length >= tiles->indexOffset && (length - tiles->indexOffset) / sizeof(uint64_t) > tiles->totalTiles &&
+             solutionLength <= m->totalPositions && start < m->totalPositions && end < m->totalPositions;
+    }
+    if (!ok) {
+        invalidFile(fileName);
+        Maze_delete(m);
+        return NULL;
+    }
+
+#ifndef _WIN32
+    void *mapping = (length <= SIZE_MAX) ? mmap(NULL, (size_t)length, PROT_READ, MAP_PRIVATE, fileno(file), 0) : MAP_FAILED;
+    ok = mapping != MAP_FAILED;
+    tiles->file = ok ? (uint8_t*)mapping : NULL;
+#else
+    tiles->file = (uint8_t*)malloc(length ? length : 1);
+    ok = tiles->file && seekFile(file, 0) && fread(tiles->file, 1, length, file) == length;
+#endif
+    if (!ok) {
+        fprintf(stderr, "Error: Maze_load could not map '%s' into memory: %s\n", fileName, strerror(errno));
+        Maze_delete(m);
+        return NULL;
+    }
+    tiles->fileSize = length;
+
+    // Every tile's bytes must lie after the index, and in order, so no tile can be made to decode outside the file
+    uint64_t previous = tiles->indexOffset + sizeof(uint64_t) * (tiles->totalTiles + 1);
+    for (MazeIndex tile = 0; ok && tile <= tiles->totalTiles; ++tile) {
+        uint64_t offset = tileOffset(tiles, tile);
+        ok = offset >= previous && offset <= length;
+        previous = offset;
+    }
+    if (!ok) {
+        invalidFile(fileName);
+        Maze_delete(m);
+        return NULL;
+    }
+    tiles->states = (uint8_t*)calloc(tiles->totalTiles, sizeof(uint8_t));
+    tiles->tilesLeft = tiles->totalTiles;
+
+    m->solutionLength = (MazeIndex)solutionLength;
+    m->start = (MazeIndex)start;
+    m->end = (MazeIndex)end;
+    m->needsLotteryRefreshed = true;
+    if (!lazily)
+        Maze_loadAll(m);
+    return m;
+}
+
+static MazeRef loadVersion2(FILE *file, uint64_t length, const char *fileName, uint32_t cores, bool lazily) {
+    uint8_t header[MAZE_FILE_HEADER_BYTES];
+    if (length < MAZE_FILE_HEADER_BYTES || fread(header, MAZE_FILE_HEADER_BYTES, 1, file) != 1) {
+        invalidFile(fileName);
+        return NULL;
+    }
+    uint32_t version = (uint32_t)loadLittleEndian(header + 4, sizeof(uint32_t));
+    uint32_t flags = (uint32_t)loadLittleEndian(header + 8, sizeof(uint32_t));
+    uint32_t dims_length = (uint32_t)loadLittleEndian(header + 12, sizeof(uint32_t));
+    if (version != MAZE_FILE_VERSION || (flags & ~(uint32_t)(mffSolution | mffBigEndian | mffSeedOnly | mffCompressed | mffTiled)) || ((flags & mffSeedOnly) && (flags & mffCompressed)) ||
+        ((flags & mffTiled) && !(flags & mffCompressed))) {
+        fprintf(stderr, "Error: Maze_load cannot read version %u of the .maze format (with flags %#x) in '%s'\n", version, flags, fileName);
+        return NULL;
+    }
+    if (!(flags & (mffSeedOnly | mffCompressed)) && ((flags & mffBigEndian) != 0) != isBigEndian()) {
+        fprintf(stderr, "Error: Maze_load cannot read '%s', which was written by a machine with the opposite byte order\n", fileName);
+        return NULL;
+    }
+    uint32_t *dims = readDims(file, length, MAZE_FILE_HEADER_BYTES, dims_length);
+    if (!dims) {
+        invalidFile(fileName);
+        return NULL;
+    }
+    uint64_t solutionLength = loadLittleEndian(header + 16, sizeof(uint64_t));
+    uint64_t start = loadLittleEndian(header + 24, sizeof(uint64_t));
+    uint64_t end = loadLittleEndian(header + 32, sizeof(uint64_t));
+    if (flags & mffSeedOnly) {
+        MazeRef m = loadSeedOnly(file, length, fileName, cores, dims, dims_length, (flags & mffSolution) != 0, start, end);
+        free(dims);
+        return m;
+    }
+    if (flags & mffTiled) {
+        MazeRef m = loadTiled(file, length, fileName, cores, dims, dims_length, (flags & mffSolution) != 0, solutionLength, start, end, lazily);
+        free(dims);
+        return m;
+    }
+    if (flags & mffCompressed) {
+        MazeRef m = loadCompressed(file, length, fileName, cores, dims, dims_length, (flags & mffSolution) != 0, solutionLength, start, end);
+        free(dims);
+        return m;
+    }
+
+    MazeRef m = createMaze(dims, dims_length, (MazeCreateFlags)(mcfOutputMaze | mcfOutputSolution), NULL, false);
+    free(dims);
+    if (!m)
+        return NULL;
+    Maze_setCores(m, cores);
+    m->solutionLength = (MazeIndex)solutionLength;
+    m->start = (MazeIndex)start;
+    m->end = (MazeIndex)end;
+
+    uint64_t offset = alignFileOffset(MAZE_FILE_HEADER_BYTES + sizeof(uint32_t) * (uint64_t)dims_length);
+    uint32_t bitmaps = (flags & mffSolution) ? 2 * dims_length : dims_length;
+    bool ok = solutionLength <= m->totalPositions && start < m->totalPositions && end < m->totalPositions &&
+              length >= offset + bitmaps * bitmapFileBytes(m);
+    if (!ok) {
+        invalidFile(fileName);
+        Maze_delete(m);
+        return NULL;
+    }
+
+#ifndef _WIN32
+    // The bitmaps are used where they lie in the file, and mapping all of it from the start keeps every one of them
+    // aligned to a whole word, whatever the page size
+    void *mapping = (length <= SIZE_MAX) ? mmap(NULL, (size_t)length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(file), 0) : MAP_FAILED;
+    if (mapping == MAP_FAILED) {
+        fprintf(stderr, "Error: Maze_load could not map '%s' into memory: %s\n", fileName, strerror(errno));
+        Maze_delete(m);
+        return NULL;
+    }
+    m->file = mapping;
+    m->fileSize = (size_t)length;
+#endif
+
+    for (uint32_t i = 0; ok && i < 2 * dims_length; ++i) {
+        BitArrayRef ba = (i < dims_length) ? m->halls[i] : m->solution[i - dims_length];
+        size_t bytes = sizeof(uint64_t) * (ba->data_length ? ba->data_length : 1);
+        if (i >= bitmaps) {
+            // A file without a solution gets an empty one
+            ba->data = (uint64_t*)malloc(bytes);
+            ok = ba->data != NULL;
+            if (ok)
+                BitArray_reset(ba);
+            continue;
+        }
+#ifndef _WIN32
+        ba->data = (uint64_t*)((uint8_t*)m->file + offset + i * bitmapFileBytes(m));
+#else
+        ba->data = (uint64_t*)malloc(bytes);
+        ok = ba->data != NULL && seekFile(file, offset + i * bitmapFileBytes(m)) && fread(ba->data, sizeof(uint64_t), ba->data_length, file) == ba->data_length;
+#endif
+    }
+
+    if (!ok) {
+        fprintf(stderr, "Error: Maze_load could not read '%s'\n", fileName);
+        Maze_delete(m);
+        return NULL;
+    }
+
+    // The bitmaps are used as they are, so a hall leading out of the maze has to be caught here
+    for (uint32_t i = 0; ok && i < bitmaps; ++i)
+        ok = !hasFarEdgeBits(m, (i < dims_length) ? m->halls[i] : m->solution[i - dims_length], i % dims_length);
+    if (!ok) {
+        invalidFile(fileName);
+        Maze_delete(m);
+        return NULL;
+    }
+    m->needsLotteryRefreshed = true;
+    return m;
+}
+
+static MazeRef loadFile(const char *fileName, uint32_t cores, bool lazily) {
+    FILE *file = fopen(fileName, "rb");
+    if (!file) {
+        fprintf(stderr, "Error: Maze_load could not open '%s': %s\n", fileName, strerror(errno));
+        return NULL;
+    }
+    uint64_t length = fileLength(file);
+    uint8_t magic[4];
+    bool version2 = length != UINT64_MAX && length >= sizeof(magic) && fread(magic, sizeof(magic), 1, file) == 1 && !memcmp(magic, "MAZE", sizeof(magic));
+
+    MazeRef m = NULL;
+    if (length == UINT64_MAX || !seekFile(file, 0))
+        fprintf(stderr, "Error: Maze_load could not read '%s'\n", fileName);
+    else if (version2)
+        m = loadVersion2(file, length, fileName, cores, lazily);
+    else
+        m = loadVersion1(file, length, fileName, cores);
+    fclose(file);
+    return m;
+}
+
+MazeRef Maze_load(const char *fileName, uint32_t cores) {
+    return loadFile(fileName, cores, false);
+}
+
+MazeRef Maze_loadLazily(const char *fileName, uint32_t cores) {
+    return loadFile(fileName, cores, true);
+}
+
+static inline MazeIndex addChild(MazeQueryRef q, MazeIndex cell, MazeIndex child) {
+    MazeIndex jump = q->jump[cell];
+    q->parent[child] = cell;
+    q->depth[child] = q->depth[cell] + 1;
+    q->jump[child] = (q->depth[cell] - q->depth[jump] == q->depth[jump] - q->depth[q->jump[jump]]) ? q->jump[jump] : cell;
+    return child;
+}
+
+// Each cell's jump is an ancestor chosen so that following jumps and parents reaches any ancestor in O(log n)
+// steps (Myers' skew-binary jump pointers), which needs only one extra index per cell, where binary lifting
+// would need log n of them. A cell's jump depends only on its depth, so two cells at the same depth always jump
+// to the same depth.
+MazeQueryRef MazeQuery_create(MazeRef m) {
+    if (!m || !m->halls) {
+        fprintf(stderr, "Error: MazeQuery_create cannot be called without setting mcfOutputMaze in Maze_create\n");
+        return NULL;
+    }
+    Maze_loadAll(m);
+
+    MazeQueryRef q = (MazeQueryRef)malloc(sizeof(MazeQuery));
+    q->m = m;
+    q->parent = (MazeIndex*)allocateArray(m, sizeof(MazeIndex) * m->totalPositions, aaRandom);
+    q->jump = (MazeIndex*)allocateArray(m, sizeof(MazeIndex) * m->totalPositions, aaRandom);
+    q->depth = (MazeIndex*)allocateArray(m, sizeof(MazeIndex) * m->totalPositions, aaRandom);
+    MazeIndex *queue = (MazeIndex*)allocateArray(m, sizeof(MazeIndex) * m->totalPositions, aaSequential);
+    if (!q->parent || !q->jump || !q->depth || !queue) {
+        freeArray(m, queue, sizeof(MazeIndex) * m->totalPositions);
+        MazeQuery_delete(q);
+        return NULL;
+    }
+
+    // A breadth-first search from cell 0 visits every parent before its children
+    MazeIndex head = 0, tail = 0;
+    if (m->totalPositions) {
+        q->parent[0] = q->jump[0] = 0;
+        q->depth[0] = 0;
+        queue[tail++] = 0;
+    }
+    while (head < tail) {
+        MazeIndex cell = queue[head++];
+        MazeIndex placeValue = 1;
+        for (uint32_t d = 0; d < m->dims_length; ++d) {
+            if (BitArray_readBit(m->halls[d], cell) && cell + placeValue != q->parent[cell])
+                queue[tail++] = addChild(q, cell, cell + placeValue);
+            if (cell >= placeValue && BitArray_readBit(m->halls[d], cell - placeValue) && cell - placeValue != q->parent[cell])
+                queue[tail++] = addChild(q, cell, cell - placeValue);
+            placeValue *= m->dims[d];
+        }
+    }
+    freeArray(m, queue, sizeof(MazeIndex) * m->totalPositions);
+    return q;
+}
+
+void MazeQuery_delete(MazeQueryRef q) {
+    if (!q)
+        return;
+    freeArray(q->m, q->parent, sizeof(MazeIndex) * q->m->totalPositions);
+    freeArray(q->m, q->jump, sizeof(MazeIndex) * q->m->totalPositions);
+    freeArray(q->m, q->depth, sizeof(MazeIndex) * q->m->totalPositions);
+    free(q);
+}
+
+static inline MazeIndex ancestorAtDepth(MazeQueryRef q, MazeIndex cell, MazeIndex depth) {
+    while (q->depth[cell] > depth)
+        cell = (q->depth[q->jump[cell]] >= depth) ? q->jump[cell] : q->parent[cell];
+    return cell;
+}
+
+MazeIndex MazeQuery_commonAncestor(MazeQueryRef q, MazeIndex a, MazeIndex b) {
+    if (q->depth[a] > q->depth[b])
+        a = ancestorAtDepth(q, a, q->depth[b]);
+    else
+        b = ancestorAtDepth(q, b, q->depth[a]);
+    while (a != b) {
+        if (q->jump[a] != q->jump[b]) {
+            a = q->jump[a];
+            b = q->jump[b];
+        } else {
+            a = q->parent[a];
+            b = q->parent[b];
+        }
+    }
+    return a;
+}
+
+MazeIndex MazeQuery_distance(MazeQueryRef q, MazeIndex a, MazeIndex b) {
+    return q->depth[a] + q->depth[b] - 2 * q->depth[MazeQuery_commonAncestor(q, a, b)];
+}
+
+MazeIndex MazeQuery_path(MazeQueryRef q, MazeIndex a, MazeIndex b, MazeIndex *cells) {
+    MazeIndex meet = MazeQuery_commonAncestor(q, a, b);
+    MazeIndex length = q->depth[a] + q->depth[b] - 2 * q->depth[meet] + 1;
+    MazeIndex i = 0;
+    for (MazeIndex cell = a; cell != meet; cell = q->parent[cell])
+        cells[i++] = cell;
+    cells[i] = meet;
+    // Climb from b too, filling the rest of the path in from its end
+    MazeIndex j = length;
+    for (MazeIndex cell = b; cell != meet; cell = q->parent[cell])
+        cells[--j] = cell;
+    return length;
 }
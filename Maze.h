@@ -17,6 +17,7 @@ extern "C" {
 #include <stdbool.h>
 #include "BitArray.h"
 #include "DisjSets.h"
+#include "Random.h"
 
 typedef enum _MazeCreateFlags {
     mcfOutputMaze = 1,
@@ -24,42 +25,277 @@ typedef enum _MazeCreateFlags {
     mcfMultipleSolves = 4,
 } MazeCreateFlags;
 
-typedef struct _Wall {
-    uint32_t cell1;
-    uint32_t cell2;
-} Wall;
+typedef enum _MazeAlgorithm {
+    maKruskal = 0, // randomized Kruskal's algorithm (single core)
+    maBoruvka = 1, // Boruvka's algorithm over random wall weights (uses m->cores)
+    maTiled = 2, // Kruskal's algorithm inside cache-sized tiles, joined by a random tree of tiles (uses m->cores, not uniform)
+} MazeAlgorithm;
+
+typedef enum _MazeSolver {
+    msDeadEndFill = 0, // repeated passes over the knocked out walls until no dead ends remain
+    msWorklist = 1, // follows each dead end back to its junction, visiting every cell at most once (requires mcfOutputMaze)
+} MazeSolver;
+
+// Cells and walls are numbered with 32-bit integers, which limits a 2D maze to 2^31 cells. Defining MAZE_64BIT
+// for the whole build (it also changes BitArray.h and DisjSets.h) numbers them with 64-bit integers instead, at
+// the cost of twice the memory for the lottery and the disjoint sets.
+#ifdef MAZE_64BIT
+typedef uint64_t MazeIndex;
+#define MAZE_INDEX_MAX UINT64_MAX
+#else
+typedef uint32_t MazeIndex;
+#define MAZE_INDEX_MAX UINT32_MAX
+#endif
+
+// A wall is packed into a MazeIndex as the cell on its near side, shifted left by wallShift bits, and the
+// dimension it lies across in the bits below that. The cell on its far side is the near cell plus
+// placeValues[dimension].
+typedef MazeIndex Wall;
+
+struct _MazeThreadPool;
+struct _MazeTiles;
 
 typedef struct _Maze {
-    uint32_t totalPositions;
-    uint32_t totalWalls;
+    MazeIndex totalPositions;
+    MazeIndex totalWalls;
     Wall *lottery;
     uint8_t *neighborCount, *neighborCountCopy;
     bool needsNeighborCountRefreshed;
+    bool needsLotteryRefreshed; // a loaded maze only has its halls, until Maze_solve() rebuilds the lottery from them
 
     uint32_t *dims;
     uint32_t dims_length;
+    MazeIndex *placeValues; // the distance between adjacent cells in each dimension
+    uint32_t wallShift; // the number of bits a Wall uses to store its dimension
     MazeCreateFlags createFlags;
     DisjSetsRef sets;
+    char *backingDirectory; // where the files behind a maze from Maze_createMapped() are made, or NULL
+    void *file; // the .maze file Maze_load() mapped into memory, which halls[] and solution[] point into, or NULL
+    size_t fileSize;
+    struct _MazeTiles *tiles; // the tiles of a file from Maze_loadLazily() that may not be decoded yet, or NULL
 
     BitArrayRef *halls;
     BitArrayRef *solution;
 
     // Trivia
-    uint32_t solutionLength;
-    uint32_t start;
-    uint32_t end;
+    MazeIndex solutionLength;
+    MazeIndex start;
+    MazeIndex end;
 
     // The number of cores to use
     uint32_t cores;
+    struct _MazeThreadPool *pool; // parked worker threads, started by the first multi-core Maze_generate() or Maze_solve()
+
+    // The algorithm Maze_generate() uses
+    MazeAlgorithm algorithm;
+
+    // The algorithm Maze_solve() uses
+    MazeSolver solver;
+
+    // The seed Maze_generate() will use next, and afterwards the seed that reproduces the current maze
+    uint64_t seed;
+    bool seedUsed; // when set, the next Maze_generate() draws a fresh seed from random
+    Random random;
 } Maze;
 typedef Maze *MazeRef;
 
+static inline Wall Maze_packWall(MazeRef m, MazeIndex cell1, uint32_t dim) {
+    return (cell1 << m->wallShift) | dim;
+}
+
+static inline uint32_t Maze_wallDim(MazeRef m, Wall wall) {
+    return (uint32_t)(wall & (((Wall)1 << m->wallShift) - 1));
+}
+
+static inline MazeIndex Maze_wallCell1(MazeRef m, Wall wall) {
+    return wall >> m->wallShift;
+}
+
+static inline MazeIndex Maze_wallCell2(MazeRef m, Wall wall) {
+    return Maze_wallCell1(m, wall) + m->placeValues[Maze_wallDim(m, wall)];
+}
+
+// Returns false if a maze with these dimensions has too many cells to be numbered with a MazeIndex
+bool Maze_canCreate(const uint32_t *dims, uint32_t length);
+
+// Returns NULL if Maze_canCreate() would return false, or the memory could not be allocated
 MazeRef Maze_create(uint32_t *dims, uint32_t length, MazeCreateFlags flags);
+
+// Like Maze_create(), but every array that grows with the maze is kept in a memory mapped file in directory, so a
+// maze can be larger than physical memory as long as it fits on disk, and gets slower rather than being killed as
+// it outgrows memory. The files are unlinked as soon as they are made, and their disk space is reserved up front.
+// The algorithm and solver default to maBoruvka and msWorklist, which sweep through the maze's arrays in order.
+MazeRef Maze_createMapped(uint32_t *dims, uint32_t length, MazeCreateFlags flags, const char *directory);
 void Maze_delete(MazeRef m);
 
 void Maze_setCores(MazeRef m, uint32_t cores);
-void Maze_generate(MazeRef m);
-void Maze_solve(MazeRef m, uint32_t start, uint32_t end);
+void Maze_setAlgorithm(MazeRef m, MazeAlgorithm algorithm);
+void Maze_setSolver(MazeRef m, MazeSolver solver);
+void Maze_setSeed(MazeRef m, uint64_t seed);
+
+// These return false if they could not run, for instance when the threads for Maze_setCores() could not be
+// started, in which case the maze is left as it was
+bool Maze_generate(MazeRef m);
+bool Maze_solve(MazeRef m, MazeIndex start, MazeIndex end);
+
+// Receives each cell of the solution from Maze_walkSolution(), in order from start to end. Returning false stops
+// the walk.
+typedef bool (*MazeCellCallback)(void *context, MazeIndex cell);
+
+// Follows the solution found by the last Maze_solve() from start to end, in O(solutionLength) time rather than
+// the O(totalPositions) it takes to scan m->solution[]. Returns false if the callback stopped it, or the maze
+// has no solution to follow.
+bool Maze_walkSolution(MazeRef m, MazeCellCallback callback, void *context);
+
+// Writes the cells of the solution from start to end into cells, which must have room for solutionLength + 1 of
+// them, and returns how many were written
+MazeIndex Maze_solutionPath(MazeRef m, MazeIndex *cells);
+
+// An index over the spanning tree of a generated maze, rooted at cell 0, which answers the distance between any
+// two cells in O(log n), and lists the path between them in O(path length), without solving the maze again. It
+// takes three MazeIndex per cell (kept on disk for a maze from Maze_createMapped()). Any number of threads may
+// query it at once, but it must be created again after the next Maze_generate(), and deleted before the maze is.
+typedef struct _MazeQuery {
+    MazeRef m;
+    MazeIndex *parent; // the next cell towards cell 0 (cell 0 is its own parent)
+    MazeIndex *jump; // an ancestor further towards cell 0 (see MazeQuery_create())
+    MazeIndex *depth; // the distance to cell 0
+} MazeQuery;
+typedef MazeQuery *MazeQueryRef;
+
+// Returns NULL if the maze was created without mcfOutputMaze, or the memory could not be allocated
+MazeQueryRef MazeQuery_create(MazeRef m);
+void MazeQuery_delete(MazeQueryRef q);
+
+// The cell where the paths from a and b to cell 0 meet, which is the one cell of the path between a and b that
+// is closest to cell 0
+MazeIndex MazeQuery_commonAncestor(MazeQueryRef q, MazeIndex a, MazeIndex b);
+
+// The number of halls between a and b
+MazeIndex MazeQuery_distance(MazeQueryRef q, MazeIndex a, MazeIndex b);
+
+// Writes the cells from a to b, including both, into cells, which must have room for MazeQuery_distance() + 1 of
+// them, and returns how many were written
+MazeIndex MazeQuery_path(MazeQueryRef q, MazeIndex a, MazeIndex b, MazeIndex *cells);
+
+// Receives each row of a maze from Maze_generateRows(), in order. Bit x of right is set if cell x of row y has a
+// hall to cell x + 1, and bit x of down is set if it has a hall to cell x of row y + 1 (like halls[0] and halls[1]
+// of a 2D maze). Both are reused for the next row. Returning false stops generating.
+typedef bool (*MazeRowCallback)(void *context, uint64_t y, BitArrayRef right, BitArrayRef down);
+
+// Generates a 2D maze one row at a time with Eller's algorithm, using memory proportional to its width alone, so its
+// height is effectively unlimited. The same seed and width always reproduce the same rows. Returns false if the
+// memory could not be allocated, or the callback stopped it.
+bool Maze_generateRows(uint32_t width, uint64_t height, uint64_t seed, MazeRowCallback callback, void *context);
+
+// Converts between per-dimension bit arrays like halls[] or solution[], and the bit-per-wall layout used by
+// version 1 .maze files, where walls are numbered in the order Maze_generate() first places them in the lottery.
+// Rows are transcoded many bits at a time, split across m->cores.
+void Maze_encodeWalls(MazeRef m, BitArrayRef *src, uint8_t *dst);
+void Maze_decodeWalls(MazeRef m, const uint8_t *src, BitArrayRef *dst);
+
+// A version 2 .maze file starts with this header, in little-endian byte order:
+//
+//   offset  0: "MAZE"
+//   offset  4: uint32_t version (2)
+//   offset  8: uint32_t flags (MazeFileFlags)
+//   offset 12: uint32_t dims_length
+//   offset 16: uint64_t solutionLength, start, end
+//   offset 40: uint32_t dims[dims_length]
+//
+// followed by the words of halls[0] to halls[dims_length - 1], then of solution[0] to solution[dims_length - 1],
+// each exactly as they are in memory, and each starting on a MAZE_FILE_ALIGNMENT boundary. A seed-only file has
+// no bitmaps, and the dims are followed straight away by:
+//
+//   uint32_t algorithm (MazeAlgorithm)
+//   uint32_t reserved (0)
+//   uint64_t seed
+//
+// A compressed file has no bitmaps either, and the dims are followed straight away by:
+//
+//   uint64_t rowsPerBlock
+//   uint64_t blockCount
+//   uint64_t blockBytes[blockCount]
+//
+// and then each block's bytes. Block i codes the halls and solution of rows i * rowsPerBlock up to
+// (i + 1) * rowsPerBlock, where a row is dims[0] cells, without reference to any other block (see Maze.c).
+//
+// A tiled file is a compressed file whose blocks are boxes of cells instead of rows, and the dims are followed
+// straight away by:
+//
+//   uint32_t tileDims[dims_length]
+//   uint64_t tileOffsets[tileCount + 1]
+//
+// where the maze is cut into ceil(dims[d] / tileDims[d]) tiles along each dimension d, numbered the same way as
+// cells, and tile i's bytes run from file offset tileOffsets[i] up to tileOffsets[i + 1]. Any tile can be found and
+// decoded on its own, without reading the rest of the file.
+//
+// Version 1 files have no header, and start straight away with dims_length (see Maze_encodeWalls()).
+#define MAZE_FILE_VERSION 2
+#define MAZE_FILE_HEADER_BYTES 40
+#define MAZE_FILE_SEED_BYTES 16
+#define MAZE_FILE_ALIGNMENT 4096
+
+typedef enum _MazeFileFlags {
+    mffSolution = 1, // solution[] follows halls[]
+    mffBigEndian = 2, // the words of halls[] and solution[] were written by a big-endian machine
+    mffSeedOnly = 4, // the maze is generated again from its seed when it is opened, and solved if mffSolution is set
+    mffCompressed = 8, // the maze, and its solution if mffSolution is set, are range coded
+    mffTiled = 16, // with mffCompressed, the blocks are tiles with an index of their offsets
+} MazeFileFlags;
+
+// Writes a version 2 .maze file. Returns false if the maze was created without mcfOutputMaze, or the file could not
+// be written.
+bool Maze_save(MazeRef m, const char *fileName);
+
+// Writes a compressed .maze file, which takes about two bits per cell for a 2D maze and its solution, where
+// Maze_save() takes four. It is coded and decoded in blocks of rows on m->cores. The solution is only kept where it
+// follows halls of the maze. Returns false if the maze was created without mcfOutputMaze, or the file could not be
+// written.
+bool Maze_saveCompressed(MazeRef m, const char *fileName);
+
+// Writes a tiled .maze file, which is compressed like Maze_saveCompressed() (though a little larger), in tiles of
+// about 65536 cells that Maze_loadLazily() can decode in any order. Returns false if the maze was created without
+// mcfOutputMaze, or the file could not be written.
+bool Maze_saveTiled(MazeRef m, const char *fileName);
+
+// Writes a seed-only .maze file of a few dozen bytes, holding just what Maze_generate() and Maze_solve() need to
+// make the maze again: its dims, m->algorithm, m->seed, and the start and end of its solution. Returns false if the
+// maze did not come from the last Maze_generate() with m->seed (because it came from Maze_load(), or
+// Maze_setSeed() has been called since), or the file could not be written. The maze is only reproduced if
+// m->algorithm hasn't been changed since it was generated.
+bool Maze_saveSeed(MazeRef m, const char *fileName);
+
+// Opens a .maze file of either version, as a maze created with mcfOutputMaze | mcfOutputSolution, and calls
+// Maze_setCores() with cores. A version 2 file is mapped into memory rather than read, with halls[] and solution[]
+// pointing straight into it, so it opens in the same time whatever its size, and its pages are only read once they
+// are used. The mapping is private, so generating a new maze over it never changes the file. Version 1 and
+// compressed files are read and decoded on every core, and a seed-only file is generated and solved again on
+// every core (and the same maze comes back whatever the number of cores). Only the halls and solution of the other
+// files are read, and the first Maze_solve() rebuilds the rest from them. Returns NULL if the file could not be
+// read, or is not a valid maze.
+MazeRef Maze_load(const char *fileName, uint32_t cores);
+
+// The same as Maze_load(), except that the tiles of a tiled file are left undecoded, so it opens in the same time
+// whatever its size. halls[] and solution[] read as zeros until Maze_loadRegion() or Maze_loadAll() decodes their
+// tiles. Maze_generate() drops the tiles that are left, and Maze_solve(), MazeQuery_create(), Maze_walkSolution()
+// and the Maze_save functions decode them first, but anything else that reads the whole maze should call
+// Maze_loadAll() before it does.
+MazeRef Maze_loadLazily(const char *fileName, uint32_t cores);
+
+// Decodes every tile holding a cell from first[d] up to end[d] in each dimension d, on the calling thread, and
+// returns once they are all decoded (including any that other threads were decoding). Does nothing for a maze that
+// wasn't opened by Maze_loadLazily(). Any number of threads may call it at once, alongside one Maze_loadAll().
+void Maze_loadRegion(MazeRef m, const uint32_t *first, const uint32_t *end);
+
+// Decodes every tile of a maze from Maze_loadLazily() that is left, on m->cores.
+void Maze_loadAll(MazeRef m);
+
+// The solution length in a version 1 .maze file is stored in 32 bits, or in 64 bits for mazes with more than 2^32 - 1
+// cells, so files of every maze a 32-bit build can create stay readable by older versions
+static inline size_t Maze_solutionLengthBytes(uint64_t totalPositions) {
+    return totalPositions > UINT32_MAX ? sizeof(uint64_t) : sizeof(uint32_t);
+}
 
 #ifdef __cplusplus
 }
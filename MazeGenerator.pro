@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT += core gui printsupport
+QT += core gui printsupport concurrent
 
 emscripten {
     QMAKE_LFLAGS +=-sASYNCIFY
@@ -22,6 +22,9 @@ TEMPLATE = app
 # deprecated API in order to know how to port your code away from it.
 DEFINES += QT_DEPRECATED_WARNINGS
 
+# Uncomment to number cells and walls with 64-bit integers, for mazes with more than 2^31 cells
+#DEFINES += MAZE_64BIT
+
 # You can also make your code fail to compile if you use deprecated APIs.
 # In order to do so, uncomment the following line.
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
@@ -33,19 +36,31 @@ SOURCES += main.cpp\
     mazewidget.cpp \
     newdialog.cpp \
     dragscrollarea.cpp \
+    mazerenderer.cpp \
+    mazetilecache.cpp \
+    mazepyramid.cpp \
+    mazeimagewriter.cpp \
     Maze.c
 
 HEADERS  += mainwindow.h \
     Maze.h \
     DisjSets.h \
+    AtomicDisjSets.h \
     BitArray.h \
+    Random.h \
     mazewidget.h \
     newdialog.h \
     generatemazeworker.h \
     deletemazeworker.h \
     dragscrollarea.h \
     openmazeworker.h \
-    savemazeworker.h
+    savemazeworker.h \
+    mazerenderer.h \
+    mazetilecache.h \
+    mazepyramid.h \
+    buildpyramidworker.h \
+    mazeimagewriter.h \
+    exportimageworker.h
 
 FORMS    += mainwindow.ui \
     about.ui \
@@ -0,0 +1,87 @@
+/*
+ *  Random.h
+ *  MazeInC
+ *
+ *  Copyright 2009-2018 Matthew T. Pandina. All rights reserved.
+ *
+ */
+
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+// xoshiro256** by David Blackman and Sebastiano Vigna, seeded through splitmix64
+typedef struct _Random {
+    uint64_t s[4];
+} Random;
+typedef Random *RandomRef;
+
+static inline uint64_t Random_rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t Random_splitmix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static inline void Random_seed(RandomRef r, uint64_t seed) {
+    for (int i = 0; i < 4; ++i)
+        r->s[i] = Random_splitmix64(&seed);
+}
+
+static inline uint64_t Random_next(RandomRef r) {
+    const uint64_t result = Random_rotl(r->s[1] * 5, 7) * 9;
+    const uint64_t t = r->s[1] << 17;
+    r->s[2] ^= r->s[0];
+    r->s[3] ^= r->s[1];
+    r->s[1] ^= r->s[2];
+    r->s[0] ^= r->s[3];
+    r->s[2] ^= t;
+    r->s[3] = Random_rotl(r->s[3], 45);
+    return result;
+}
+
+// Returns the full 128-bit product of a and b, split into its high and low halves
+static inline uint64_t Random_multiply(uint64_t a, uint64_t b, uint64_t *low) {
+#ifdef __SIZEOF_INT128__
+    __uint128_t product = (__uint128_t)a * b;
+    *low = (uint64_t)product;
+    return (uint64_t)(product >> 64);
+#else
+    uint64_t aLow = (uint32_t)a, aHigh = a >> 32;
+    uint64_t bLow = (uint32_t)b, bHigh = b >> 32;
+    uint64_t lowLow = aLow * bLow;
+    uint64_t highLow = aHigh * bLow;
+    uint64_t lowHigh = aLow * bHigh;
+    uint64_t cross = (lowLow >> 32) + (uint32_t)highLow + lowHigh;
+    *low = (cross << 32) | (uint32_t)lowLow;
+    return aHigh * bHigh + (highLow >> 32) + (cross >> 32);
+#endif
+}
+
+// Returns a uniformly distributed value in [0, range) using Lemire's nearly divisionless method, which
+// rejects the few products that would otherwise make some values more likely than others
+static inline uint64_t Random_bounded(RandomRef r, uint64_t range) {
+    uint64_t low;
+    uint64_t high = Random_multiply(Random_next(r), range, &low);
+    if (low < range) {
+        uint64_t threshold = -range % range;
+        while (low < threshold)
+            high = Random_multiply(Random_next(r), range, &low);
+    }
+    return high;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RANDOM_H
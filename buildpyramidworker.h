@@ -0,0 +1,39 @@
+/*
+ *  buildpyramidworker.h
+ *  MazeGenerator
+ *
+ *  Copyright 2018-2024 Matthew T. Pandina. All rights reserved.
+ *
+ */
+
+#ifndef BUILDPYRAMIDWORKER_H
+#define BUILDPYRAMIDWORKER_H
+
+#include <QObject>
+#include "Maze.h"
+#include "mazepyramid.h"
+
+class BuildPyramidWorker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit BuildPyramidWorker(MazeRef myMaze) : myMaze(myMaze)
+    {
+
+    }
+
+signals:
+    void buildPyramidWorker_finished(void *maze, void *pyramid);
+
+public slots:
+    void process() {
+        // Runs after whatever generated or opened the maze, and before anything queued after it can change the maze
+        MazePyramid *pyramid = MazePyramid::build(myMaze);
+        emit buildPyramidWorker_finished((void*)myMaze, (void*)pyramid);
+    }
+
+private:
+    MazeRef myMaze = 0;
+};
+
+#endif // BUILDPYRAMIDWORKER_H
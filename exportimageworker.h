@@ -0,0 +1,161 @@
+/*
+ *  exportimageworker.h
+ *  MazeGenerator
+ *
+ *  Copyright 2018-2024 Matthew T. Pandina. All rights reserved.
+ *
+ */
+
+#ifndef EXPORTIMAGEWORKER_H
+#define EXPORTIMAGEWORKER_H
+
+#include <QObject>
+#include <QString>
+#include <QImage>
+#include <QImageWriter>
+#include <QFileInfo>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrent>
+
+#include "mazerenderer.h"
+#include "mazeimagewriter.h"
+
+#define MAZE_EXPORT_BAND_BYTES (32 * 1024 * 1024) // how much of the image each band is drawn into at once
+
+// Exports the maze a band of rows at a time, drawing as many bands at once as there are cores. BMP files are written a
+// batch of bands at a time, before the next batch is drawn, so an image of any size needs only a few bands' worth of
+// memory. Without antialiasing, the image is drawn with 1 or 8 bits per pixel (see MazeRenderer::imageFormat()).
+class ExportImageWorker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ExportImageWorker(const MazeRenderer &renderer, QString fileName, qreal scaling, bool showMaze, bool showSolution) :
+        renderer(renderer), fileName(fileName), scaling(scaling), showMaze(showMaze), showSolution(showSolution)
+    {
+
+    }
+
+signals:
+    void exportImageWorker_exportingImage();
+    void exportImageWorker_finished();
+    void exportImageWorker_error(QString err);
+
+public slots:
+    void process() {
+        emit exportImageWorker_exportingImage();
+
+        qint64 width = (qint64)((renderer.mazeWidth + 1) * renderer.gridSpacing * scaling);
+        qint64 height = (qint64)((renderer.mazeHeight + 1) * renderer.gridSpacing * scaling);
+        format = renderer.imageFormat(showMaze, showSolution);
+        colors = renderer.imageColors(showMaze, showSolution);
+        // Bands that can't be rasterized are drawn in color first, whatever format they end up in
+        int bitsPerPixel = renderer.canRasterize(scaling) ? QImage::toPixelFormat(format).bitsPerPixel() : 32;
+        qint64 bytesPerLine = (width * bitsPerPixel + 31) / 32 * 4;
+        if (width < 1 || height < 1 || bytesPerLine > MAZE_EXPORT_BAND_BYTES || height > 0x7FFFFFFF) {
+            emit exportImageWorker_error(QString("The maze is too large to export at this size.\n\nYou may configure its rendered size using the View > Maze Styles menu."));
+            return;
+        }
+        bandHeight = (int)(MAZE_EXPORT_BAND_BYTES / bytesPerLine);
+
+        QString err = (QFileInfo(fileName).suffix().compare("png", Qt::CaseInsensitive) == 0) ? exportPng((int)width, (int)height) : exportBmp((int)width, (int)height);
+        if (!err.isNull()) {
+            emit exportImageWorker_error(err);
+            return;
+        }
+        emit exportImageWorker_finished();
+    }
+
+private:
+    QImage createImage(int width, int height) const {
+        QImage image(width, height, format);
+        if (!image.isNull() && !colors.isEmpty())
+            image.setColorTable(colors);
+        return image;
+    }
+
+    // Streams the image to the file a batch of bands at a time
+    QString exportBmp(int width, int height) {
+        MazeImageWriter writer;
+        if (!writer.open(fileName, width, height, format, colors))
+            return QString("The file '%1' could not be written: %2").arg(fileName, writer.errorString());
+
+#ifdef Q_OS_WASM
+        int idealThreads = 2;
+#else
+        int idealThreads = QThread::idealThreadCount();
+#endif
+        int bandCount = (height + bandHeight - 1) / bandHeight;
+        int batchSize = (idealThreads > 0) ? idealThreads : 1;
+        QVector<int> batch;
+        QVector<QByteArray> encoded(batchSize);
+        for (int firstBand = 0; firstBand < bandCount; firstBand += batchSize) {
+            batch.clear();
+            for (int band = firstBand; band < qMin(firstBand + batchSize, bandCount); ++band)
+                batch.append(band);
+
+            QByteArray *results = encoded.data();
+            QtConcurrent::blockingMap(batch, [&](int band) {
+                int top = band * bandHeight;
+                QImage image = createImage(width, qMin(bandHeight, height - top));
+                if (image.isNull())
+                    return; // leaves its result empty
+                renderer.renderImage(&image, QPoint(0, top), scaling, showMaze, showSolution);
+                results[band - firstBand] = writer.encodeBand(image);
+            });
+
+            for (int band : batch) {
+                QByteArray &rows = encoded[band - firstBand];
+                if (rows.isEmpty()) {
+                    writer.close();
+                    return QString("There was not enough memory to export the image.");
+                }
+                if (!writer.writeBand(band * bandHeight, rows)) {
+                    QString err = QString("The file '%1' could not be written: %2").arg(fileName, writer.errorString());
+                    writer.close();
+                    return err;
+                }
+                rows.clear();
+            }
+        }
+
+        if (!writer.close())
+            return QString("The file '%1' could not be written: %2").arg(fileName, writer.errorString());
+        return QString();
+    }
+
+    // PNG files are compressed as one stream, so the whole image is drawn first, though its bands are still drawn on
+    // every core, straight into its rows. Qt writes Mono and Indexed8 images with 1 and 8 bits per pixel.
+    QString exportPng(int width, int height) {
+        QImage image = createImage(width, height);
+        if (image.isNull())
+            return QString("There was not enough memory to export the image; the maze is most likely too large.\n\nYou may export it as a BMP file instead, which is written a part at a time.");
+
+        uchar *bits = image.bits();
+        QVector<int> bands;
+        for (int top = 0; top < height; top += bandHeight)
+            bands.append(top);
+        QtConcurrent::blockingMap(bands, [&](int top) {
+            QImage band(bits + (qint64)top * image.bytesPerLine(), width, qMin(bandHeight, height - top), image.bytesPerLine(), format);
+            if (!colors.isEmpty())
+                band.setColorTable(colors);
+            renderer.renderImage(&band, QPoint(0, top), scaling, showMaze, showSolution);
+        });
+
+        QImageWriter writer(fileName, "png");
+        if (!writer.write(image))
+            return QString("The file '%1' could not be written: %2").arg(fileName, writer.errorString());
+        return QString();
+    }
+
+    MazeRenderer renderer;
+    QString fileName;
+    qreal scaling;
+    bool showMaze;
+    bool showSolution;
+    QImage::Format format = QImage::Format_ARGB32_Premultiplied;
+    QVector<QRgb> colors;
+    int bandHeight = 1;
+};
+
+#endif // EXPORTIMAGEWORKER_H
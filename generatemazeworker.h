@@ -13,6 +13,8 @@
 #include <QThread>
 #include "Maze.h"
 
+#define BORUVKA_MIN_CORES 3 // on fewer cores than this, Kruskal's algorithm generates mazes faster
+
 class GenerateMazeWorker : public QObject
 {
     Q_OBJECT
@@ -28,7 +30,7 @@ signals:
     void generateMazeWorker_generatingMaze();
     void generateMazeWorker_solvingMaze();
     void generateMazeWorker_finished(void *myMaze);
-    void generateMazeWorker_error(QString err);
+    void generateMazeWorker_error(void *myMaze, QString err);
 
 public slots:
     void process() {
@@ -38,6 +40,10 @@ public slots:
             Maze_delete(myMaze);
             emit generateMazeWorker_allocatingMemory();
             myMaze = Maze_create(dims, 2, (MazeCreateFlags)(mcfOutputMaze | mcfOutputSolution /*| mcfMultipleSolves*/));
+            if (!myMaze) {
+                emit generateMazeWorker_error((void*)myMaze, QString("There is not enough memory for a %1 by %2 maze, or it has too many cells.").arg(mazeWidth).arg(mazeHeight));
+                return;
+            }
 #ifdef Q_OS_WASM
             int idealThreads = 2;
 #else
@@ -45,12 +51,22 @@ public slots:
 #endif
             if (idealThreads > 0)
                 Maze_setCores(myMaze, idealThreads);
+            // Borůvka's algorithm is slower than Kruskal's on one core, and only pays for itself with a few to share
+            // the work between
+            Maze_setAlgorithm(myMaze, (idealThreads >= BORUVKA_MIN_CORES) ? maBoruvka : maKruskal);
+            Maze_setSolver(myMaze, msWorklist);
         }
 
         emit generateMazeWorker_generatingMaze();
-        Maze_generate(myMaze);
+        if (!Maze_generate(myMaze)) {
+            emit generateMazeWorker_error((void*)myMaze, QString("The maze could not be generated using %1 threads.").arg(myMaze->cores));
+            return;
+        }
         emit generateMazeWorker_solvingMaze();
-        Maze_solve(myMaze, 0, myMaze->totalPositions - 1);
+        if (!Maze_solve(myMaze, 0, myMaze->totalPositions - 1)) {
+            emit generateMazeWorker_error((void*)myMaze, QString("The maze could not be solved using %1 threads.").arg(myMaze->cores));
+            return;
+        }
         emit generateMazeWorker_finished((void*)myMaze);
     }
 
@@ -44,6 +44,8 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(mazeWidget, &MazeWidget::on_generatingMaze, this, &MainWindow::on_generatingMaze);
     connect(mazeWidget, &MazeWidget::on_solvingMaze, this, &MainWindow::on_solvingMaze);
     connect(mazeWidget, &MazeWidget::on_mazeCreated, this, &MainWindow::on_mazeCreated);
+    connect(mazeWidget, &MazeWidget::on_generateMazeError, this, &MainWindow::on_generateMazeError);
+    connect(mazeWidget, &MazeWidget::on_generateMazePostError, this, &MainWindow::enableMenuItemsAndRefreshStatusBar);
     connect(mazeWidget, &MazeWidget::openMazeWorker_start, this, &MainWindow::openMazeWorker_start);
     connect(mazeWidget, &MazeWidget::on_openMaze, this, &MainWindow::on_openMaze);
     connect(mazeWidget, &MazeWidget::on_openMazeError, this, &MainWindow::on_openMazeError);
@@ -52,6 +54,10 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(mazeWidget, &MazeWidget::on_savingMaze, this, &MainWindow::on_savingMaze);
     connect(mazeWidget, &MazeWidget::on_saveMazeError, this, &MainWindow::on_saveMazeError);
     connect(mazeWidget, &MazeWidget::on_mazeSaved, this, &MainWindow::on_mazeSaved);
+    connect(mazeWidget, &MazeWidget::exportImageWorker_start, this, &MainWindow::saveMazeWorker_start);
+    connect(mazeWidget, &MazeWidget::on_exportingImage, this, &MainWindow::on_exportingImage);
+    connect(mazeWidget, &MazeWidget::on_exportImageError, this, &MainWindow::on_saveMazeError);
+    connect(mazeWidget, &MazeWidget::on_imageExported, this, &MainWindow::on_mazeSaved);
 }
 
 MainWindow::~MainWindow()
@@ -205,12 +211,18 @@ void MainWindow::on_mazeCreated()
     enableMenuItemsAndRefreshStatusBar();
 }
 
+void MainWindow::on_generateMazeError(QString err)
+{
+    (void)err; // silence unused warning
+    QApplication::restoreOverrideCursor();
+}
+
 void MainWindow::enableMenuItemsAndRefreshStatusBar()
 {
     enableMenuItems(true);
-    int w = mazeWidget->getMazeWidth();
-    int h = mazeWidget->getMazeHeight();
-    int s = mazeWidget->getSolutionLength();
+    qint64 w = mazeWidget->getMazeWidth();
+    qint64 h = mazeWidget->getMazeHeight();
+    qint64 s = mazeWidget->getSolutionLength();
     permanentStatus.setText(QString("<b>Size: %1x%2, Cells: %3, Walls: %4, Solution Length: %5</b>")
                             .arg(w)
                             .arg(h)
@@ -235,6 +247,11 @@ void MainWindow::on_savingMaze()
     permanentStatus.setText("<b>Saving Maze...</b>");
 }
 
+void MainWindow::on_exportingImage()
+{
+    permanentStatus.setText("<b>Exporting Image...</b>");
+}
+
 void MainWindow::on_saveMazeError(QString err)
 {
     (void)err; // silence unused warning
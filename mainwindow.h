@@ -57,6 +57,7 @@ private slots:
     void on_generatingMaze();
     void on_solvingMaze();
     void on_mazeCreated();
+    void on_generateMazeError(QString err);
     void enableMenuItemsAndRefreshStatusBar();
 
     void on_openMaze();
@@ -65,6 +66,7 @@ private slots:
     void on_savingMaze();
     void on_saveMazeError(QString err);
     void on_mazeSaved();
+    void on_exportingImage();
 
     void openMazeWorker_start();
     void saveMazeWorker_start();
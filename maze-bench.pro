@@ -0,0 +1,21 @@
+#-------------------------------------------------
+#
+# Benchmark for the maze engine (does not use Qt)
+#
+#-------------------------------------------------
+
+TARGET = maze-bench
+TEMPLATE = app
+CONFIG += console
+CONFIG -= qt app_bundle
+
+unix: LIBS += -lpthread -lm
+
+SOURCES += mazebench.c \
+    Maze.c
+
+HEADERS += Maze.h \
+    DisjSets.h \
+    AtomicDisjSets.h \
+    BitArray.h \
+    Random.h
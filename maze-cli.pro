@@ -0,0 +1,21 @@
+#-------------------------------------------------
+#
+# Headless command-line front-end (does not use Qt)
+#
+#-------------------------------------------------
+
+TARGET = maze-cli
+TEMPLATE = app
+CONFIG += console
+CONFIG -= qt app_bundle
+
+unix: LIBS += -lpthread
+
+SOURCES += mazecli.c \
+    Maze.c
+
+HEADERS += Maze.h \
+    DisjSets.h \
+    AtomicDisjSets.h \
+    BitArray.h \
+    Random.h
@@ -0,0 +1,675 @@
+/*
+ *  mazebench.c
+ *  MazeInC
+ *
+ *  Copyright 2009-2018 Matthew T. Pandina. All rights reserved.
+ *
+ */
+
+// Benchmarks Maze_create(), Maze_generate() and Maze_solve() over a sweep of maze sizes, dimensions and core
+// counts. Every configuration runs in its own child process, so its peak RSS can be measured on its own.
+// With -u, it instead stress tests and benchmarks AtomicDisjSets against DisjSets. With -f, it instead checks that
+// mazes of several shapes come back unchanged from every .maze format, and can be solved again once opened.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <pthread.h>
+
+#include "Maze.h"
+#include "AtomicDisjSets.h"
+
+#define MAX_DIMS 8
+#define MAX_REPS 64
+#define PHASES 3
+
+static const char *phaseNames[PHASES] = { "create", "generate", "solve" };
+
+typedef struct _Result {
+    uint32_t dims_length;
+    uint32_t side;
+    uint64_t cells;
+    uint32_t cores;
+    uint32_t reps;
+    double best[PHASES];
+    double mean[PHASES];
+    long peakRSS; // in KiB
+} Result;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "\n"
+            "Options:\n"
+            "  -m cells      largest maze to benchmark (default: 1073741824)\n"
+            "  -d dims       comma separated numbers of dimensions to sweep (default: 2,3)\n"
+            "  -c cores      largest number of cores to sweep up to (default: all of them)\n"
+            "  -r reps       repetitions of each configuration (default: 3)\n"
+            "  -a algorithm  kruskal, boruvka or tiled (default: boruvka)\n"
+            "  -S solver     deadend or worklist (default: worklist)\n"
+            "  -s seed       seed for every maze (default: 1)\n"
+            "  -j            write JSON instead of CSV\n"
+            "  -u            benchmark the union-find structures instead, over -m elements (default: 16777216)\n"
+            "  -f            check that mazes survive saving and opening in every .maze format instead\n",
+            program);
+}
+
+// Runs every repetition of one configuration in the child, writing its timings down the pipe
+static void runChild(int fd, uint32_t dims_length, uint32_t side, uint32_t cores, uint32_t reps, MazeAlgorithm algorithm, MazeSolver solver, uint64_t seed) {
+    uint32_t dims[MAX_DIMS];
+    for (uint32_t i = 0; i < dims_length; ++i)
+        dims[i] = side;
+
+    double timings[MAX_REPS][PHASES];
+    for (uint32_t r = 0; r < reps; ++r) {
+        double t = now();
+        MazeRef m = Maze_create(dims, dims_length, (MazeCreateFlags)(mcfOutputMaze | mcfOutputSolution));
+        if (!m)
+            _exit(1);
+        Maze_setCores(m, cores);
+        Maze_setAlgorithm(m, algorithm);
+        Maze_setSolver(m, solver);
+        Maze_setSeed(m, seed);
+        timings[r][0] = now() - t;
+
+        t = now();
+        if (!Maze_generate(m))
+            _exit(1);
+        timings[r][1] = now() - t;
+
+        t = now();
+        if (!Maze_solve(m, 0, m->totalPositions - 1))
+            _exit(1);
+        timings[r][2] = now() - t;
+
+        Maze_delete(m);
+    }
+    ssize_t size = sizeof(double) * PHASES * reps;
+    _exit(write(fd, timings, size) == size ? 0 : 1);
+}
+
+static bool runConfiguration(Result *result, MazeAlgorithm algorithm, MazeSolver solver, uint64_t seed) {
+    int fds[2];
+    if (pipe(fds))
+        return false;
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        runChild(fds[1], result->dims_length, result->side, result->cores, result->reps, algorithm, solver, seed);
+    }
+    close(fds[1]);
+
+    double timings[MAX_REPS][PHASES];
+    ssize_t size = sizeof(double) * PHASES * result->reps;
+    ssize_t got = 0;
+    while (got < size) {
+        ssize_t n = read(fds[0], (uint8_t*)timings + got, size - got);
+        if (n <= 0)
+            break;
+        got += n;
+    }
+    close(fds[0]);
+
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0 || got != size)
+        return false;
+
+    result->peakRSS = usage.ru_maxrss;
+    for (int p = 0; p < PHASES; ++p) {
+        result->best[p] = timings[0][p];
+        result->mean[p] = 0;
+        for (uint32_t r = 0; r < result->reps; ++r) {
+            if (timings[r][p] < result->best[p])
+                result->best[p] = timings[r][p];
+            result->mean[p] += timings[r][p] / result->reps;
+        }
+    }
+    return true;
+}
+
+static void printResult(const Result *result, const Result *singleCore, bool json, bool *first) {
+    for (int p = 0; p < PHASES; ++p) {
+        double speedup = (singleCore && result->best[p] > 0) ? singleCore->best[p] / result->best[p] : 1.0;
+        double nsPerCell = result->best[p] * 1e9 / result->cells;
+        if (json) {
+            printf("%s\n  {\"dims\": %u, \"side\": %u, \"cells\": %llu, \"cores\": %u, \"phase\": \"%s\", \"reps\": %u, "
+                   "\"best_s\": %.6f, \"mean_s\": %.6f, \"ns_per_cell\": %.3f, \"speedup\": %.3f, \"peak_rss_kib\": %ld}",
+                   *first ? "" : ",", result->dims_length, result->side, (unsigned long long)result->cells, result->cores,
+                   phaseNames[p], result->reps, result->best[p], result->mean[p], nsPerCell, speedup, result->peakRSS);
+        } else {
+            printf("%u,%u,%llu,%u,%s,%u,%.6f,%.6f,%.3f,%.3f,%ld\n",
+                   result->dims_length, result->side, (unsigned long long)result->cells, result->cores,
+                   phaseNames[p], result->reps, result->best[p], result->mean[p], nsPerCell, speedup, result->peakRSS);
+        }
+        *first = false;
+    }
+    fflush(stdout);
+}
+
+// Union-find benchmark: every structure unions the same random pairs of elements, which are split evenly between
+// the threads. Afterwards, each concurrent run must have partitioned the elements exactly like DisjSets did.
+
+typedef enum _UnionFindKind {
+    ufkDisjSets,
+    ufkAtomic32,
+    ufkAtomic64,
+} UnionFindKind;
+
+static const char *unionFindNames[] = { "DisjSets", "AtomicDisjSets", "AtomicDisjSets64" };
+
+typedef struct _UnionFindInfo {
+    UnionFindKind kind;
+    void *sets;
+    const uint32_t *pairs;
+    uint32_t startPair;
+    uint32_t endPair;
+    uint32_t unions;
+} UnionFindInfo;
+
+static void *unionFindThreaded(void *arg) {
+    UnionFindInfo *ufi = (UnionFindInfo*)arg;
+    uint32_t unions = 0;
+    for (uint32_t i = ufi->startPair; i < ufi->endPair; ++i) {
+        uint32_t x = ufi->pairs[2 * i], y = ufi->pairs[2 * i + 1];
+        switch (ufi->kind) {
+        case ufkDisjSets: {
+            DisjSetsIndex root1 = DisjSets_find((DisjSetsRef)ufi->sets, x);
+            DisjSetsIndex root2 = DisjSets_find((DisjSetsRef)ufi->sets, y);
+            if (root1 != root2) {
+                DisjSets_union((DisjSetsRef)ufi->sets, root1, root2);
+                unions++;
+            }
+            break;
+        }
+        case ufkAtomic32:
+            unions += AtomicDisjSets_union((AtomicDisjSetsRef)ufi->sets, x, y);
+            break;
+        case ufkAtomic64:
+            unions += AtomicDisjSets64_union((AtomicDisjSets64Ref)ufi->sets, x, y);
+            break;
+        }
+    }
+    ufi->unions = unions;
+    return 0;
+}
+
+static uint64_t unionFindRoot(UnionFindKind kind, void *sets, uint32_t x) {
+    switch (kind) {
+    case ufkDisjSets:
+        return (uint64_t)DisjSets_find((DisjSetsRef)sets, x);
+    case ufkAtomic32:
+        return AtomicDisjSets_find((AtomicDisjSetsRef)sets, x);
+    default:
+        return AtomicDisjSets64_find((AtomicDisjSets64Ref)sets, x);
+    }
+}
+
+// Times one run, and checks its partition against the sequential one in expectedRoots
+static bool runUnionFind(UnionFindKind kind, uint32_t elements, const uint32_t *pairs, uint32_t threads, const uint32_t *expectedRoots, uint64_t *rootMap, double *seconds) {
+    void *sets;
+    if (kind == ufkDisjSets)
+        sets = DisjSets_create(elements);
+    else if (kind == ufkAtomic32)
+        sets = AtomicDisjSets_create(elements);
+    else
+        sets = AtomicDisjSets64_create(elements);
+
+    UnionFindInfo ufi[threads];
+    pthread_t t[threads];
+    uint32_t chunkSize = elements / threads;
+    for (uint32_t i = 0; i < threads; ++i) {
+        ufi[i].kind = kind;
+        ufi[i].sets = sets;
+        ufi[i].pairs = pairs;
+        ufi[i].startPair = i * chunkSize;
+        ufi[i].endPair = (i == threads - 1) ? elements : (i + 1) * chunkSize;
+    }
+
+    double start = now();
+    uint32_t started = 0;
+    for (; started < threads; ++started)
+        if (pthread_create(&t[started], NULL, unionFindThreaded, &ufi[started]))
+            break;
+    for (uint32_t i = 0; i < started; ++i)
+        pthread_join(t[i], NULL);
+    *seconds = now() - start;
+    bool ok = (started == threads);
+
+    if (ok && expectedRoots) {
+        // Each expected set must map onto exactly one set of this run, and both runs must have made the same
+        // number of unions, which together mean both have the same number of sets too
+        uint32_t unions = 0;
+        for (uint32_t i = 0; i < threads; ++i)
+            unions += ufi[i].unions;
+        uint32_t expectedUnions = 0;
+        for (uint32_t x = 0; x < elements; ++x) {
+            expectedUnions += (expectedRoots[x] != x);
+            rootMap[x] = UINT64_MAX;
+        }
+        ok = (unions == expectedUnions);
+        for (uint32_t x = 0; ok && x < elements; ++x) {
+            uint64_t root = unionFindRoot(kind, sets, x);
+            if (rootMap[expectedRoots[x]] == UINT64_MAX)
+                rootMap[expectedRoots[x]] = root;
+            ok = (rootMap[expectedRoots[x]] == root);
+        }
+    }
+
+    free(sets);
+    return ok;
+}
+
+static int benchmarkUnionFind(uint32_t elements, long maxCores, uint32_t reps, uint64_t seed, bool json) {
+    if (elements < 2)
+        elements = 2;
+    uint32_t *pairs = (uint32_t*)malloc(sizeof(uint32_t) * 2 * (size_t)elements);
+    uint32_t *expectedRoots = (uint32_t*)malloc(sizeof(uint32_t) * elements);
+    uint64_t *rootMap = (uint64_t*)malloc(sizeof(uint64_t) * elements);
+    if (!pairs || !expectedRoots || !rootMap) {
+        fprintf(stderr, "Error: not enough memory for %u elements\n", elements);
+        return 1;
+    }
+
+    Random random;
+    Random_seed(&random, seed);
+    for (size_t i = 0; i < 2 * (size_t)elements; ++i)
+        pairs[i] = (uint32_t)Random_bounded(&random, elements);
+
+    // The sequential partition that every other run is checked against, with each set named by its smallest element
+    DisjSetsRef reference = DisjSets_create(elements);
+    for (uint32_t i = 0; i < elements; ++i) {
+        DisjSetsIndex root1 = DisjSets_find(reference, pairs[2 * i]);
+        DisjSetsIndex root2 = DisjSets_find(reference, pairs[2 * i + 1]);
+        if (root1 != root2)
+            DisjSets_union(reference, root1, root2);
+    }
+    for (uint32_t x = 0; x < elements; ++x)
+        rootMap[x] = UINT64_MAX;
+    for (uint32_t x = 0; x < elements; ++x) {
+        uint32_t root = (uint32_t)DisjSets_find(reference, x);
+        if (rootMap[root] == UINT64_MAX)
+            rootMap[root] = x;
+        expectedRoots[x] = (uint32_t)rootMap[root];
+    }
+    DisjSets_delete(reference);
+
+    if (json)
+        printf("[");
+    else
+        printf("structure,elements,threads,reps,best_s,mean_s,ns_per_union,speedup,ok\n");
+
+    int rc = 0;
+    bool first = true;
+    double baseline = 0;
+    for (int kind = ufkDisjSets; kind <= ufkAtomic64; ++kind) {
+        for (uint32_t threads = 1; ; threads *= 2) {
+            if (threads > (uint32_t)maxCores)
+                threads = (uint32_t)maxCores;
+            if (kind == ufkDisjSets)
+                threads = 1; // DisjSets is not thread safe
+
+            double best = 0, mean = 0;
+            bool ok = true;
+            for (uint32_t r = 0; r < reps; ++r) {
+                double seconds;
+                ok = runUnionFind((UnionFindKind)kind, elements, pairs, threads, expectedRoots, rootMap, &seconds) && ok;
+                if (r == 0 || seconds < best)
+                    best = seconds;
+                mean += seconds / reps;
+            }
+            if (kind == ufkDisjSets)
+                baseline = best;
+            if (!ok) {
+                fprintf(stderr, "Error: %s on %u threads did not match DisjSets\n", unionFindNames[kind], threads);
+                rc = 1;
+            }
+
+            double speedup = best > 0 ? baseline / best : 1.0;
+            if (json) {
+                printf("%s\n  {\"structure\": \"%s\", \"elements\": %u, \"threads\": %u, \"reps\": %u, \"best_s\": %.6f, "
+                       "\"mean_s\": %.6f, \"ns_per_union\": %.3f, \"speedup\": %.3f, \"ok\": %s}",
+                       first ? "" : ",", unionFindNames[kind], elements, threads, reps, best, mean, best * 1e9 / elements, speedup, ok ? "true" : "false");
+            } else {
+                printf("%s,%u,%u,%u,%.6f,%.6f,%.3f,%.3f,%d\n",
+                       unionFindNames[kind], elements, threads, reps, best, mean, best * 1e9 / elements, speedup, ok);
+            }
+            first = false;
+            fflush(stdout);
+
+            if (threads == (uint32_t)maxCores || kind == ufkDisjSets)
+                break;
+        }
+    }
+
+    if (json)
+        printf("\n]\n");
+    free(rootMap);
+    free(expectedRoots);
+    free(pairs);
+    return rc;
+}
+
+// File round trip check: every maze is saved in each format and opened again on 1 and on -c cores, and must come back
+// with the same halls, solution, start and end. Each one that is opened is then solved again with both solvers,
+// which must find the same solution.
+
+typedef enum _FileFormat {
+    ffVersion1,
+    ffVersion2,
+    ffSeedOnly,
+    ffCompressed,
+    ffTiled,
+    ffTiledLazily,
+} FileFormat;
+
+static const char *fileFormatNames[] = { "version1", "version2", "seed-only", "compressed", "tiled", "tiled-lazily" };
+
+static bool writeLittleEndian(FILE *file, uint64_t value, size_t size) {
+    uint8_t bytes[sizeof(uint64_t)];
+    for (size_t i = 0; i < size; ++i)
+        bytes[i] = (uint8_t)(value >> (8 * i));
+    return fwrite(bytes, size, 1, file) == 1;
+}
+
+// Maze.c only reads version 1 files, so the check writes its own with Maze_encodeWalls()
+static bool saveVersion1(MazeRef m, const char *fileName) {
+    FILE *file = fopen(fileName, "wb");
+    if (!file)
+        return false;
+    size_t bytes = (size_t)(m->totalWalls / 8 + ((m->totalWalls % 8) ? 1 : 0));
+    uint8_t *walls = (uint8_t*)malloc(bytes ? bytes : 1);
+    bool ok = walls && writeLittleEndian(file, m->dims_length, sizeof(uint32_t));
+    for (uint32_t i = 0; ok && i < m->dims_length; ++i)
+        ok = writeLittleEndian(file, m->dims[i], sizeof(uint32_t));
+    if (ok)
+        Maze_encodeWalls(m, m->halls, walls);
+    ok = ok && fwrite(walls, 1, bytes, file) == bytes;
+    ok = ok && writeLittleEndian(file, m->solutionLength, Maze_solutionLengthBytes(m->totalPositions));
+    if (ok)
+        Maze_encodeWalls(m, m->solution, walls);
+    ok = ok && fwrite(walls, 1, bytes, file) == bytes;
+    free(walls);
+    return (fclose(file) == 0) && ok;
+}
+
+static bool saveFile(MazeRef m, FileFormat format, const char *fileName) {
+    switch (format) {
+    case ffVersion1:
+        return saveVersion1(m, fileName);
+    case ffVersion2:
+        return Maze_save(m, fileName);
+    case ffSeedOnly:
+        return Maze_saveSeed(m, fileName);
+    case ffCompressed:
+        return Maze_saveCompressed(m, fileName);
+    default:
+        return Maze_saveTiled(m, fileName);
+    }
+}
+
+// Compares the bits of every cell from first up to end, in each dimension, or of every cell if first is NULL
+static bool sameBits(MazeRef expected, BitArrayRef *expectedBits, BitArrayRef *bits, const uint32_t *first, const uint32_t *end) {
+    for (MazeIndex cell = 0; cell < expected->totalPositions; ++cell) {
+        MazeIndex rest = cell;
+        bool inside = true;
+        for (uint32_t d = 0; d < expected->dims_length; ++d) {
+            uint32_t coord = (uint32_t)(rest % expected->dims[d]);
+            rest /= expected->dims[d];
+            inside = inside && (!first || (coord >= first[d] && coord < end[d]));
+        }
+        for (uint32_t d = 0; inside && d < expected->dims_length; ++d)
+            if (BitArray_readBit(expectedBits[d], cell) != BitArray_readBit(bits[d], cell))
+                return false;
+    }
+    return true;
+}
+
+static bool sameMaze(MazeRef expected, MazeRef m) {
+    return m->dims_length == expected->dims_length && !memcmp(m->dims, expected->dims, sizeof(uint32_t) * m->dims_length) &&
+           m->solutionLength == expected->solutionLength && m->start == expected->start && m->end == expected->end &&
+           sameBits(expected, expected->halls, m->halls, NULL, NULL) && sameBits(expected, expected->solution, m->solution, NULL, NULL);
+}
+
+static bool checkFile(MazeRef expected, FileFormat format, const char *fileName, uint32_t cores) {
+    if (!saveFile(expected, format, fileName))
+        return false;
+    bool ok = true;
+    for (int solver = msDeadEndFill; ok && solver <= msWorklist; ++solver) {
+        MazeRef m = (format == ffTiledLazily) ? Maze_loadLazily(fileName, cores) : Maze_load(fileName, cores);
+        if (!m)
+            return false;
+        if (format == ffTiledLazily) {
+            // The middle of the maze must be decoded on its own before the rest is
+            uint32_t first[MAX_DIMS], end[MAX_DIMS];
+            for (uint32_t d = 0; d < m->dims_length; ++d) {
+                first[d] = m->dims[d] / 3;
+                end[d] = m->dims[d] - m->dims[d] / 3;
+            }
+            Maze_loadRegion(m, first, end);
+            ok = sameBits(expected, expected->halls, m->halls, first, end) && sameBits(expected, expected->solution, m->solution, first, end);
+            Maze_loadAll(m);
+        }
+        ok = ok && sameMaze(expected, m);
+
+        for (uint32_t d = 0; ok && d < m->dims_length; ++d)
+            BitArray_reset(m->solution[d]);
+        Maze_setSolver(m, (MazeSolver)solver);
+        ok = ok && Maze_solve(m, expected->start, expected->end) && sameMaze(expected, m);
+        Maze_delete(m);
+    }
+    return ok;
+}
+
+static int checkFiles(long maxCores, MazeAlgorithm algorithm, uint64_t seed, bool json) {
+    static const uint32_t shapes[][MAX_DIMS] = { { 1, 17 }, { 17, 1 }, { 41, 29 }, { 7, 5, 3 }, { 700, 300 } };
+    static const uint32_t shapeDims[] = { 2, 2, 2, 3, 2 };
+    const char *directory = getenv("TMPDIR");
+    char fileName[4096];
+    snprintf(fileName, sizeof(fileName), "%s/mazebench-%ld.maze", (directory && *directory) ? directory : "/tmp", (long)getpid());
+
+    if (json)
+        printf("[");
+    else
+        printf("format,dims,cores,ok\n");
+
+    int rc = 0;
+    bool first = true;
+    for (size_t s = 0; s < sizeof(shapeDims) / sizeof(shapeDims[0]); ++s) {
+        MazeRef expected = Maze_create((uint32_t*)shapes[s], shapeDims[s], (MazeCreateFlags)(mcfOutputMaze | mcfOutputSolution));
+        if (!expected)
+            return 1;
+        Maze_setAlgorithm(expected, algorithm);
+        Maze_setSeed(expected, seed);
+        if (!Maze_generate(expected) || !Maze_solve(expected, 0, expected->totalPositions - 1)) {
+            Maze_delete(expected);
+            return 1;
+        }
+
+        char dims[64];
+        int length = 0;
+        for (uint32_t d = 0; d < shapeDims[s]; ++d)
+            length += snprintf(dims + length, sizeof(dims) - length, d ? "x%u" : "%u", shapes[s][d]);
+
+        for (int format = ffVersion1; format <= ffTiledLazily; ++format) {
+            for (uint32_t cores = 1; ; cores = (uint32_t)maxCores) {
+                bool ok = checkFile(expected, (FileFormat)format, fileName, cores);
+                if (!ok) {
+                    fprintf(stderr, "Error: a %s maze did not survive a %s file on %u cores\n", dims, fileFormatNames[format], cores);
+                    rc = 1;
+                }
+                if (json)
+                    printf("%s\n  {\"format\": \"%s\", \"dims\": \"%s\", \"cores\": %u, \"ok\": %s}", first ? "" : ",", fileFormatNames[format], dims, cores, ok ? "true" : "false");
+                else
+                    printf("%s,%s,%u,%d\n", fileFormatNames[format], dims, cores, ok);
+                first = false;
+                fflush(stdout);
+                if (cores == (uint32_t)maxCores)
+                    break;
+            }
+        }
+        Maze_delete(expected);
+    }
+    unlink(fileName);
+
+    if (json)
+        printf("\n]\n");
+    return rc;
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t maxCells = 1ULL << 30;
+    bool haveMaxCells = false;
+    bool unionFind = false;
+    bool files = false;
+    uint32_t dimsList[MAX_DIMS] = { 2, 3 };
+    uint32_t dimsCount = 2;
+    long maxCores = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t reps = 3;
+    MazeAlgorithm algorithm = maBoruvka;
+    MazeSolver solver = msWorklist;
+    uint64_t seed = 1;
+    bool json = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "m:d:c:r:a:S:s:jufh")) != -1) {
+        switch (opt) {
+        case 'm':
+            maxCells = strtoull(optarg, NULL, 0);
+            haveMaxCells = true;
+            break;
+        case 'd': {
+            dimsCount = 0;
+            for (char *token = strtok(optarg, ","); token && dimsCount < MAX_DIMS; token = strtok(NULL, ",")) {
+                long value = atol(token);
+                if (value >= 1 && value <= MAX_DIMS)
+                    dimsList[dimsCount++] = (uint32_t)value;
+            }
+            break;
+        }
+        case 'c':
+            maxCores = atol(optarg);
+            break;
+        case 'r':
+            reps = (uint32_t)atol(optarg);
+            if (reps < 1)
+                reps = 1;
+            if (reps > MAX_REPS)
+                reps = MAX_REPS;
+            break;
+        case 'a':
+            if (!strcmp(optarg, "kruskal"))
+                algorithm = maKruskal;
+            else if (!strcmp(optarg, "boruvka"))
+                algorithm = maBoruvka;
+            else if (!strcmp(optarg, "tiled"))
+                algorithm = maTiled;
+            else {
+                fprintf(stderr, "Error: unknown algorithm '%s'\n", optarg);
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'S':
+            if (!strcmp(optarg, "deadend"))
+                solver = msDeadEndFill;
+            else if (!strcmp(optarg, "worklist"))
+                solver = msWorklist;
+            else {
+                fprintf(stderr, "Error: unknown solver '%s'\n", optarg);
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 's':
+            seed = strtoull(optarg, NULL, 0);
+            break;
+        case 'j':
+            json = true;
+            break;
+        case 'u':
+            unionFind = true;
+            break;
+        case 'f':
+            files = true;
+            break;
+        default:
+            usage(argv[0]);
+            return (opt == 'h') ? 0 : 1;
+        }
+    }
+    if (maxCores < 1)
+        maxCores = 1;
+
+    if (files)
+        return checkFiles(maxCores, algorithm, seed, json);
+
+    if (unionFind) {
+        uint64_t elements = haveMaxCells ? maxCells : 1ULL << 24;
+        return benchmarkUnionFind(elements > UINT32_MAX ? UINT32_MAX : (uint32_t)elements, maxCores, reps, seed, json);
+    }
+
+    if (json)
+        printf("[");
+    else
+        printf("dims,side,cells,cores,phase,reps,best_s,mean_s,ns_per_cell,speedup,peak_rss_kib\n");
+
+    bool first = true;
+    for (uint32_t d = 0; d < dimsCount; ++d) {
+        // 1K, 32K, 1M, 32M and 1G cells, as close as a maze with equal sides can get to each of them
+        for (uint64_t target = 1ULL << 10; target <= maxCells; target <<= 5) {
+            Result singleCore;
+            bool haveSingleCore = false;
+            for (uint32_t cores = 1; ; cores *= 2) { // 1, 2, 4, ... and finally maxCores itself
+                if (cores > (uint32_t)maxCores)
+                    cores = (uint32_t)maxCores;
+                Result result;
+                uint32_t dims[MAX_DIMS];
+                result.dims_length = dimsList[d];
+                result.side = (uint32_t)llround(pow((double)target, 1.0 / dimsList[d]));
+                result.cells = 1;
+                for (uint32_t i = 0; i < dimsList[d]; ++i) {
+                    dims[i] = result.side;
+                    result.cells *= result.side;
+                }
+                result.cores = cores;
+                result.reps = reps;
+
+                if (!Maze_canCreate(dims, result.dims_length) || !runConfiguration(&result, algorithm, solver, seed)) {
+                    fprintf(stderr, "Error: %u-D maze with %llu cells on %u cores failed to run\n", result.dims_length, (unsigned long long)result.cells, cores);
+                } else {
+                    if (cores == 1) {
+                        singleCore = result;
+                        haveSingleCore = true;
+                    }
+                    printResult(&result, haveSingleCore ? &singleCore : NULL, json, &first);
+                }
+                if (cores == (uint32_t)maxCores)
+                    break;
+            }
+        }
+    }
+
+    if (json)
+        printf("\n]\n");
+    return 0;
+}
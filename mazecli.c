@@ -0,0 +1,346 @@
+/*
+ *  mazecli.c
+ *  MazeInC
+ *
+ *  Copyright 2009-2018 Matthew T. Pandina. All rights reserved.
+ *
+ */
+
+// A headless front-end to Maze.c, for generating and solving mazes on machines without Qt or a display.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "Maze.h"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Parses a whole number from 1 to UINT32_MAX, with nothing before or after it
+static bool parseCount(const char *text, uint32_t *value) {
+    if (*text < '0' || *text > '9')
+        return false; // strtoull() would skip spaces, and wrap negative numbers around
+    char *end;
+    errno = 0;
+    unsigned long long parsed = strtoull(text, &end, 10);
+    if (errno || *end || parsed < 1 || parsed > UINT32_MAX)
+        return false;
+    *value = (uint32_t)parsed;
+    return true;
+}
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [options] dim1 [dim2 ...]\n"
+            "\n"
+            "Options:\n"
+            "  -s seed       seed to generate the maze from (default: random)\n"
+            "  -c cores      number of cores to use (default: all of them)\n"
+            "  -a algorithm  kruskal, boruvka or tiled (default: boruvka)\n"
+            "  -S solver     deadend or worklist (default: worklist)\n"
+            "  -n            don't solve the maze\n"
+            "  -q pairs      index the maze, and time the distances between this many random pairs of cells\n"
+            "  -o file       write the maze to a .maze file\n"
+            "  -z            with -o, write a seed-only .maze file, which is generated again when it is opened\n"
+            "  -x            with -o, write a compressed .maze file\n"
+            "  -t            with -o, write a tiled .maze file, which can be opened a region at a time\n"
+            "  -P file       write the solution to a text file, one cell's coordinates per line from start to end\n"
+            "  -m directory  keep the maze in memory mapped files in directory, for mazes larger than memory\n"
+            "  -e            stream a 2D maze to the -o file one row at a time with Eller's algorithm, using\n"
+            "                memory proportional to its width (the maze is not solved)\n",
+            program);
+}
+
+static bool writeLittleEndian(FILE *file, uint64_t value, size_t size) {
+    uint8_t bytes[8];
+    for (size_t i = 0; i < size; ++i)
+        bytes[i] = (uint8_t)(value >> (8 * i));
+    return fwrite(bytes, size, 1, file) == 1;
+}
+
+typedef struct _PathWriter {
+    FILE *file;
+    MazeRef m;
+} PathWriter;
+
+static bool writeCell(void *context, MazeIndex cell) {
+    PathWriter *writer = (PathWriter*)context;
+    for (uint32_t d = 0; d < writer->m->dims_length; ++d) {
+        if (fprintf(writer->file, d ? " %u" : "%u", (unsigned)(cell % writer->m->dims[d])) < 0)
+            return false;
+        cell /= writer->m->dims[d];
+    }
+    return fputc('\n', writer->file) != EOF;
+}
+
+static bool savePath(MazeRef m, const char *fileName) {
+    FILE *file = fopen(fileName, "w");
+    if (!file)
+        return false;
+    PathWriter writer = { file, m };
+    bool ok = Maze_walkSolution(m, writeCell, &writer);
+    if (fclose(file) != 0)
+        ok = false;
+    return ok;
+}
+
+typedef struct _RowWriter {
+    FILE *file;
+    uint32_t width;
+    uint64_t height;
+    uint8_t byte; // bits waiting to be written, lowest first
+    uint32_t bitCount;
+} RowWriter;
+
+static bool writeBit(RowWriter *writer, bool bit) {
+    writer->byte |= (uint8_t)bit << writer->bitCount;
+    if (++writer->bitCount < 8)
+        return true;
+    bool ok = fputc(writer->byte, writer->file) != EOF;
+    writer->byte = 0;
+    writer->bitCount = 0;
+    return ok;
+}
+
+// Walls are numbered cell by cell in .maze files, with the wall to the right of a cell before the one below it, so
+// each row's bits follow straight on from the previous row's
+static bool writeRow(void *context, uint64_t y, BitArrayRef right, BitArrayRef down) {
+    RowWriter *writer = (RowWriter*)context;
+    bool ok = true;
+    for (uint32_t x = 0; ok && x < writer->width; ++x) {
+        if (x + 1 < writer->width)
+            ok = writeBit(writer, BitArray_readBit(right, x));
+        if (ok && y + 1 < writer->height)
+            ok = writeBit(writer, BitArray_readBit(down, x));
+    }
+    return ok;
+}
+
+// Writes a version 1 .maze file (see Maze_encodeWalls()), without ever holding more than one row of the maze in memory
+static bool streamMaze(uint32_t width, uint32_t height, uint64_t seed, const char *fileName) {
+    FILE *file = fopen(fileName, "wb");
+    if (!file)
+        return false;
+
+    uint64_t totalPositions = (uint64_t)width * height;
+    uint64_t totalWalls = (uint64_t)(width - 1) * height + (uint64_t)width * (height - 1);
+    uint64_t data_length = totalWalls / 8 + ((totalWalls % 8) ? 1 : 0);
+    bool ok = writeLittleEndian(file, 2, sizeof(uint32_t)) && writeLittleEndian(file, width, sizeof(uint32_t)) && writeLittleEndian(file, height, sizeof(uint32_t));
+
+    RowWriter writer = { file, width, height, 0, 0 };
+    ok = ok && Maze_generateRows(width, height, seed, writeRow, &writer);
+    if (ok && writer.bitCount)
+        ok = fputc(writer.byte, file) != EOF;
+
+    // An empty solution
+    ok = ok && writeLittleEndian(file, 0, Maze_solutionLengthBytes(totalPositions));
+    for (uint64_t i = 0; ok && i < data_length; ++i)
+        ok = fputc(0, file) != EOF;
+
+    if (fclose(file) != 0)
+        ok = false;
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t seed = 0;
+    bool haveSeed = false;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    MazeAlgorithm algorithm = maBoruvka;
+    MazeSolver solver = msWorklist;
+    bool solve = true;
+    const char *fileName = NULL;
+    const char *mapDirectory = NULL;
+    const char *pathFileName = NULL;
+    bool stream = false;
+    bool seedOnly = false;
+    bool compressed = false;
+    bool tiled = false;
+    unsigned long queries = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:c:a:S:nq:o:zxtP:m:eh")) != -1) {
+        switch (opt) {
+        case 's':
+            seed = strtoull(optarg, NULL, 0);
+            haveSeed = true;
+            break;
+        case 'c': {
+            uint32_t value;
+            if (!parseCount(optarg, &value)) {
+                fprintf(stderr, "Error: '%s' is not a valid number of cores\n", optarg);
+                return 1;
+            }
+            cores = value;
+            break;
+        }
+        case 'a':
+            if (!strcmp(optarg, "kruskal"))
+                algorithm = maKruskal;
+            else if (!strcmp(optarg, "boruvka"))
+                algorithm = maBoruvka;
+            else if (!strcmp(optarg, "tiled"))
+                algorithm = maTiled;
+            else {
+                fprintf(stderr, "Error: unknown algorithm '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'S':
+            if (!strcmp(optarg, "deadend"))
+                solver = msDeadEndFill;
+            else if (!strcmp(optarg, "worklist"))
+                solver = msWorklist;
+            else {
+                fprintf(stderr, "Error: unknown solver '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'n':
+            solve = false;
+            break;
+        case 'q':
+            queries = strtoul(optarg, NULL, 0);
+            break;
+        case 'o':
+            fileName = optarg;
+            break;
+        case 'z':
+            seedOnly = true;
+            break;
+        case 'x':
+            compressed = true;
+            break;
+        case 't':
+            tiled = true;
+            break;
+        case 'P':
+            pathFileName = optarg;
+            break;
+        case 'm':
+            mapDirectory = optarg;
+            break;
+        case 'e':
+            stream = true;
+            break;
+        default:
+            usage(argv[0]);
+            return (opt == 'h') ? 0 : 1;
+        }
+    }
+
+    uint32_t length = argc - optind;
+    if (length == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    uint32_t *dims = (uint32_t*)malloc(sizeof(uint32_t) * length);
+    for (uint32_t i = 0; i < length; ++i) {
+        if (!parseCount(argv[optind + i], &dims[i])) {
+            fprintf(stderr, "Error: '%s' is not a valid dimension\n", argv[optind + i]);
+            return 1;
+        }
+    }
+
+    if (stream) {
+        if (length != 2 || !fileName) {
+            fprintf(stderr, "Error: -e needs two dimensions and an -o file\n");
+            return 1;
+        }
+        if (!haveSeed)
+            seed = ((uint64_t)time(NULL) << 32) ^ ((uint64_t)getpid() << 16) ^ (uint64_t)clock();
+        double t = now();
+        bool ok = streamMaze(dims[0], dims[1], seed, fileName);
+        free(dims);
+        if (!ok) {
+            fprintf(stderr, "Error: the file '%s' could not be written\n", fileName);
+            return 1;
+        }
+        printf("Generating and saving: %.3f s (seed %llu, Eller's algorithm)\n", now() - t, (unsigned long long)seed);
+        return 0;
+    }
+
+    double t = now();
+    MazeRef m = Maze_createMapped(dims, length, (MazeCreateFlags)(mcfOutputMaze | mcfOutputSolution), mapDirectory);
+    free(dims);
+    if (!m)
+        return 1;
+    if (cores > 0)
+        Maze_setCores(m, (uint32_t)cores);
+    Maze_setAlgorithm(m, algorithm);
+    Maze_setSolver(m, solver);
+    if (haveSeed)
+        Maze_setSeed(m, seed);
+    printf("Allocating: %.3f s\n", now() - t);
+
+    t = now();
+    if (!Maze_generate(m)) {
+        Maze_delete(m);
+        return 1;
+    }
+    printf("Generating: %.3f s (seed %llu, %u cores, %llu cells)\n", now() - t, (unsigned long long)m->seed, m->cores, (unsigned long long)m->totalPositions);
+
+    if (solve) {
+        t = now();
+        if (!Maze_solve(m, 0, m->totalPositions - 1)) {
+            Maze_delete(m);
+            return 1;
+        }
+        printf("Solving: %.3f s (solution length %llu)\n", now() - t, (unsigned long long)m->solutionLength);
+    }
+
+    if (queries) {
+        t = now();
+        MazeQueryRef q = MazeQuery_create(m);
+        if (!q) {
+            Maze_delete(m);
+            return 1;
+        }
+        printf("Indexing: %.3f s\n", now() - t);
+
+        Random random;
+        Random_seed(&random, m->seed);
+        uint64_t totalDistance = 0;
+        t = now();
+        for (unsigned long i = 0; i < queries; ++i) {
+            MazeIndex a = (MazeIndex)Random_bounded(&random, m->totalPositions);
+            MazeIndex b = (MazeIndex)Random_bounded(&random, m->totalPositions);
+            totalDistance += MazeQuery_distance(q, a, b);
+        }
+        printf("Querying: %.3f s (%lu pairs, mean distance %.1f)\n", now() - t, queries, (double)totalDistance / queries);
+        MazeQuery_delete(q);
+    }
+
+    int rc = 0;
+    if (fileName) {
+        t = now();
+        bool saved = seedOnly ? Maze_saveSeed(m, fileName) : compressed ? Maze_saveCompressed(m, fileName) :
+                     tiled ? Maze_saveTiled(m, fileName) : Maze_save(m, fileName);
+        if (saved)
+            printf("Saving: %.3f s\n", now() - t);
+        else
+            rc = 1;
+    }
+
+    if (pathFileName && solve) {
+        t = now();
+        if (savePath(m, pathFileName)) {
+            printf("Saving path: %.3f s\n", now() - t);
+        } else {
+            fprintf(stderr, "Error: the file '%s' could not be written\n", pathFileName);
+            rc = 1;
+        }
+    }
+
+    t = now();
+    Maze_delete(m);
+    printf("Deleting: %.3f s\n", now() - t);
+    return rc;
+}
@@ -0,0 +1,106 @@
+/*
+ *  mazeimagewriter.cpp
+ *  MazeGenerator
+ *
+ *  Copyright 2018-2024 Matthew T. Pandina. All rights reserved.
+ *
+ */
+
+#include "mazeimagewriter.h"
+
+#include <cstring>
+
+#define BMP_FILE_HEADER_SIZE 14
+#define BMP_INFO_HEADER_SIZE 40
+#define BMP_PIXELS_PER_METER 2835 // 72 DPI
+
+static void appendLittleEndian(QByteArray *bytes, quint64 value, int size)
+{
+    for (int i = 0; i < size; ++i)
+        bytes->append((char)(value >> (8 * i)));
+}
+
+bool MazeImageWriter::open(const QString &fileName, int width, int height, QImage::Format format, const QVector<QRgb> &colors)
+{
+    this->width = width;
+    this->height = height;
+    bitsPerPixel = (format == QImage::Format_Mono) ? 1 : (format == QImage::Format_Indexed8) ? 8 : 24;
+    int colorCount = (bitsPerPixel == 24) ? 0 : colors.size();
+    bytesPerLine = ((qint64)width * bitsPerPixel + 31) / 32 * 4;
+    dataOffset = BMP_FILE_HEADER_SIZE + BMP_INFO_HEADER_SIZE + 4 * colorCount;
+    qint64 fileSize = dataOffset + bytesPerLine * height;
+
+    // The sizes are only 32 bits; readers work them out from the width and height when they are 0
+    QByteArray header;
+    header.append("BM");
+    appendLittleEndian(&header, (fileSize <= 0xFFFFFFFF) ? fileSize : 0, 4);
+    appendLittleEndian(&header, 0, 4);
+    appendLittleEndian(&header, dataOffset, 4);
+    appendLittleEndian(&header, BMP_INFO_HEADER_SIZE, 4);
+    appendLittleEndian(&header, width, 4);
+    appendLittleEndian(&header, height, 4); // positive, so the rows are stored bottom up, as every reader expects
+    appendLittleEndian(&header, 1, 2); // planes
+    appendLittleEndian(&header, bitsPerPixel, 2);
+    appendLittleEndian(&header, 0, 4); // BI_RGB
+    appendLittleEndian(&header, (fileSize - dataOffset <= 0xFFFFFFFF) ? fileSize - dataOffset : 0, 4);
+    appendLittleEndian(&header, BMP_PIXELS_PER_METER, 4);
+    appendLittleEndian(&header, BMP_PIXELS_PER_METER, 4);
+    appendLittleEndian(&header, colorCount, 4); // colors used
+    appendLittleEndian(&header, 0, 4); // important colors
+    for (int i = 0; i < colorCount; ++i) {
+        header.append((char)qBlue(colors[i]));
+        header.append((char)qGreen(colors[i]));
+        header.append((char)qRed(colors[i]));
+        header.append((char)0);
+    }
+
+    file.setFileName(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    if (file.write(header) != header.size() || !file.resize(fileSize)) {
+        file.close();
+        return false;
+    }
+    return true;
+}
+
+QByteArray MazeImageWriter::encodeBand(const QImage &band) const
+{
+    QByteArray rows((int)(bytesPerLine * band.height()), 0);
+    for (int y = 0; y < band.height(); ++y) {
+        const QRgb *pixels = (const QRgb*)band.constScanLine(y);
+        uchar *row = (uchar*)rows.data() + bytesPerLine * (band.height() - 1 - y);
+        if (bitsPerPixel < 24) {
+            // Mono images order their bits the same way, most significant first
+            memcpy(row, band.constScanLine(y), ((qint64)width * bitsPerPixel + 7) / 8);
+            continue;
+        }
+        for (int x = 0; x < width; ++x) {
+            // Every pixel is opaque, so premultiplying has changed nothing
+            row[3 * x] = (uchar)qBlue(pixels[x]);
+            row[3 * x + 1] = (uchar)qGreen(pixels[x]);
+            row[3 * x + 2] = (uchar)qRed(pixels[x]);
+        }
+    }
+    return rows;
+}
+
+bool MazeImageWriter::writeBand(int top, const QByteArray &rows)
+{
+    qint64 bandHeight = rows.size() / bytesPerLine;
+    if (!file.seek(dataOffset + (height - top - bandHeight) * bytesPerLine))
+        return false;
+    return file.write(rows) == rows.size();
+}
+
+bool MazeImageWriter::close()
+{
+    bool flushed = file.flush();
+    file.close();
+    return flushed && file.error() == QFileDevice::NoError;
+}
+
+QString MazeImageWriter::errorString() const
+{
+    return file.errorString();
+}
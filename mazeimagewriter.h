@@ -0,0 +1,47 @@
+/*
+ *  mazeimagewriter.h
+ *  MazeGenerator
+ *
+ *  Copyright 2018-2024 Matthew T. Pandina. All rights reserved.
+ *
+ */
+
+#ifndef MAZEIMAGEWRITER_H
+#define MAZEIMAGEWRITER_H
+
+#include <QFile>
+#include <QImage>
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+// Writes a BMP file a band of rows at a time, so an image far larger than memory can be exported. Bands may be written
+// in any order, since each one is written straight to where its rows belong in the file. Mono and Indexed8 images are
+// written with 1 and 8 bits per pixel and their color tables, and anything else with 24.
+class MazeImageWriter
+{
+public:
+    // Writes the headers, and makes room for every row
+    bool open(const QString &fileName, int width, int height, QImage::Format format = QImage::Format_ARGB32_Premultiplied,
+              const QVector<QRgb> &colors = QVector<QRgb>());
+
+    // Converts band (in the format given to open(), as wide as the image) into the file's rows, bottom row first as BMP files
+    // store them. This only reads band, so it may run on any thread, while other bands are encoded or written.
+    QByteArray encodeBand(const QImage &band) const;
+
+    // Writes the rows from encodeBand() of the band whose first row is top
+    bool writeBand(int top, const QByteArray &rows);
+
+    bool close();
+    QString errorString() const;
+
+private:
+    QFile file;
+    int width = 0;
+    int height = 0;
+    int bitsPerPixel = 24;
+    qint64 bytesPerLine = 0; // padded to a multiple of 4
+    qint64 dataOffset = 0;
+};
+
+#endif // MAZEIMAGEWRITER_H
@@ -0,0 +1,160 @@
+/*
+ *  mazepyramid.cpp
+ *  MazeGenerator
+ *
+ *  Copyright 2018-2024 Matthew T. Pandina. All rights reserved.
+ *
+ */
+
+#include "mazepyramid.h"
+
+#include <QtConcurrent>
+#include <cmath>
+
+static QImage createLevel(int width, int height)
+{
+    QImage level(width, height, QImage::Format_Indexed8);
+    if (!level.isNull())
+        level.setColorCount(256);
+    return level;
+}
+
+// Runs rowFunc for every row from 0 to height on all cores
+template <typename RowFunc>
+static void forEachRow(int height, RowFunc rowFunc)
+{
+    QVector<int> rows(height);
+    for (int y = 0; y < height; ++y)
+        rows[y] = y;
+    QtConcurrent::blockingMap(rows, [&rowFunc](int y) { rowFunc(y); });
+}
+
+#define MAZE_PYRAMID_SOLUTION 0x80 // set in texels the solution passes through
+#define MAZE_PYRAMID_WALLS 0x7F // the rest count the standing walls, from 0 to 127
+
+MazePyramid *MazePyramid::build(MazeRef maze)
+{
+    if (!maze || maze->dims_length != 2)
+        return NULL;
+    Maze_loadAll(maze);
+
+    MazePyramid *pyramid = new MazePyramid;
+    pyramid->mazeWidth = (int)maze->dims[0];
+    pyramid->mazeHeight = (int)maze->dims[1];
+    int width = pyramid->mazeWidth;
+    int height = pyramid->mazeHeight;
+
+    // Large mazes start at a coarser level (see MAZE_PYRAMID_MAX_TEXELS)
+    int &first = pyramid->firstLevel;
+    while (first < 30 && (((qint64)width + (1 << first) - 1) >> first) * (((qint64)height + (1 << first) - 1) >> first) > MAZE_PYRAMID_MAX_TEXELS)
+        first++;
+
+    // The first level comes straight from the maze. Every cell counts two walls: the one to its right and the one below
+    // it, where the border stands in for them at the far edges.
+    int block = 1 << first;
+    QImage level = createLevel((width + block - 1) / block, (height + block - 1) / block);
+    if (level.isNull()) {
+        delete pyramid;
+        return NULL;
+    }
+    // Rows are found with 64-bit offsets from bits(), taken once, rather than with scanLine() on every thread, which
+    // would have them all checking whether the image needs detaching at once
+    uchar *bits = level.bits();
+    qint64 bytesPerLine = level.bytesPerLine();
+    forEachRow(level.height(), [&](int texelY) {
+        uchar *texels = bits + texelY * bytesPerLine;
+        for (int texelX = 0; texelX < level.width(); ++texelX) {
+            qint64 standing = 0;
+            qint64 total = 0;
+            bool onSolution = false;
+            for (int y = texelY * block; y < qMin(texelY * block + block, height); ++y) {
+                for (int x = texelX * block; x < qMin(texelX * block + block, width); ++x) {
+                    MazeIndex cell = (MazeIndex)y * width + x;
+                    standing += (x == width - 1 || !BitArray_readBit(maze->halls[0], cell)) + (y == height - 1 || !BitArray_readBit(maze->halls[1], cell));
+                    total += 2;
+                    onSolution = onSolution || BitArray_readBit(maze->solution[0], cell) || BitArray_readBit(maze->solution[1], cell);
+                }
+            }
+            texels[texelX] = (uchar)(standing * MAZE_PYRAMID_WALLS / total) | (onSolution ? MAZE_PYRAMID_SOLUTION : 0);
+        }
+    });
+    pyramid->levels.append(level);
+
+    // Each level after that averages the walls of 2 by 2 texels of the one before, and keeps the solution wherever any
+    // of them had it
+    while (level.width() > 1 || level.height() > 1) {
+        const QImage &fine = pyramid->levels.last();
+        level = createLevel((fine.width() + 1) / 2, (fine.height() + 1) / 2);
+        if (level.isNull())
+            break; // the levels so far are still usable
+        bits = level.bits();
+        bytesPerLine = level.bytesPerLine();
+        forEachRow(level.height(), [&](int texelY) {
+            uchar *texels = bits + texelY * bytesPerLine;
+            for (int texelX = 0; texelX < level.width(); ++texelX) {
+                int standing = 0;
+                int total = 0;
+                uchar onSolution = 0;
+                for (int y = 2 * texelY; y < qMin(2 * texelY + 2, fine.height()); ++y) {
+                    for (int x = 2 * texelX; x < qMin(2 * texelX + 2, fine.width()); ++x) {
+                        uchar texel = fine.constScanLine(y)[x];
+                        standing += texel & MAZE_PYRAMID_WALLS;
+                        total++;
+                        onSolution |= texel & MAZE_PYRAMID_SOLUTION;
+                    }
+                }
+                texels[texelX] = (uchar)(standing / total) | onSolution;
+            }
+        });
+        pyramid->levels.append(level);
+    }
+    return pyramid;
+}
+
+void MazePyramid::paint(QPainter *painter, const QRect &rect, const MazeRenderer &renderer, qreal scaling, bool showMaze, bool showSolution) const
+{
+    qreal cell = renderer.gridSpacing * scaling; // in pixels
+    int level = qBound(firstLevel, (int)std::floor(std::log2(1.0 / cell)), firstLevel + levels.size() - 1);
+    qreal texel = cell * (1 << level);
+
+    // The texels under rect, where the top left of cell (0, 0) is half a cell in from the top left of the widget
+    qreal origin = 0.5 * cell;
+    const QImage &image = levels[level - firstLevel];
+    QRect source = QRect(QPoint((int)std::floor((rect.left() - origin) / texel), (int)std::floor((rect.top() - origin) / texel)),
+                         QPoint((int)std::floor((rect.right() + 1 - origin) / texel), (int)std::floor((rect.bottom() + 1 - origin) / texel))).intersected(image.rect());
+    if (source.isEmpty())
+        return;
+    QRectF target(origin + source.left() * texel, origin + source.top() * texel, source.width() * texel, source.height() * texel);
+
+    painter->save();
+    painter->resetTransform();
+    painter->setRenderHint(QPainter::SmoothPixmapTransform);
+    painter->setClipRect(QRectF(origin, origin, mazeWidth * cell, mazeHeight * cell).intersected(QRectF(rect)), Qt::IntersectClip);
+
+    // The same texels are drawn once for each layer, with a color table that picks out that layer's bits
+    QImage part = image.copy(source);
+    if (showMaze) {
+        // How much of a block is black when every wall in it is standing, for walls (or when none are, for paths): each
+        // cell's two lines cover thickness by spacing each, overlapping where they meet
+        qreal spacing = renderer.gridSpacing;
+        qreal thickness = renderer.wallThickness;
+        qreal coverage = qMin((2 * thickness * spacing - thickness * thickness) / (spacing * spacing), 1.0);
+        QVector<QRgb> colors(256);
+        for (int i = 0; i < 256; ++i) {
+            qreal standing = (i & MAZE_PYRAMID_WALLS) / (qreal)MAZE_PYRAMID_WALLS;
+            int gray = qRound(255 * (1 - coverage * (renderer.inverse ? 1 - standing : standing)));
+            colors[i] = qRgb(gray, gray, gray);
+        }
+        part.setColorTable(colors);
+        painter->drawImage(target, part);
+    }
+    if (showSolution) {
+        QVector<QRgb> colors(256, qRgba(0, 0, 0, 0));
+        for (int i = MAZE_PYRAMID_SOLUTION; i < 256; ++i)
+            colors[i] = qRgb(255, 0, 0);
+        part.setColorTable(colors);
+        painter->drawImage(target, part);
+    }
+
+    painter->restore();
+}
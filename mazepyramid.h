@@ -0,0 +1,49 @@
+/*
+ *  mazepyramid.h
+ *  MazeGenerator
+ *
+ *  Copyright 2018-2024 Matthew T. Pandina. All rights reserved.
+ *
+ */
+
+#ifndef MAZEPYRAMID_H
+#define MAZEPYRAMID_H
+
+#include <QImage>
+#include <QVector>
+#include <QPainter>
+#include <QRect>
+
+#include "Maze.h"
+#include "mazerenderer.h"
+
+#define MAZE_PYRAMID_MAX_TEXELS (64 * 1024 * 1024) // the most texels (bytes) the finest level may have
+
+// An overview of a maze for drawing it when its cells are smaller than a pixel, in time proportional to the pixels drawn
+// rather than to the cells. Level k has a texel for every 2^k by 2^k block of cells. Each texel is one byte: the low 7
+// bits hold how many of the block's walls are standing (0 to 127), and the top bit is set if the solution passes
+// through it. It doesn't depend on the style the maze is drawn in, so it only needs building once the maze is
+// generated or opened.
+//
+// Level 1 costs 2 bits per cell, half as much as the maze's own halls and solution bitmaps, so on large mazes the
+// pyramid starts at the first level with no more than MAZE_PYRAMID_MAX_TEXELS texels, and those mazes are drawn from
+// that level (scaled up) until their cells are at least that small. Every level after the first adds a quarter as
+// many again, so the whole pyramid is at most 4/3 of its first level: 2.7 bits per cell, or about 85 MB.
+class MazePyramid
+{
+public:
+    // Builds every level on all cores, and returns NULL if there isn't the memory for it
+    static MazePyramid *build(MazeRef maze);
+
+    // Draws whichever level's texels come closest to the size of the pixels in rect (in the widget's pixels, whatever
+    // painter's transform), scaled smoothly to fit
+    void paint(QPainter *painter, const QRect &rect, const MazeRenderer &renderer, qreal scaling, bool showMaze, bool showSolution) const;
+
+private:
+    QVector<QImage> levels; // levels[i] is level firstLevel + i, in Format_Indexed8
+    int firstLevel = 1;
+    int mazeWidth = 0;
+    int mazeHeight = 0;
+};
+
+#endif // MAZEPYRAMID_H
@@ -0,0 +1,503 @@
+/*
+ *  mazerenderer.cpp
+ *  MazeGenerator
+ *
+ *  Copyright 2018-2024 Matthew T. Pandina. All rights reserved.
+ *
+ */
+
+#include "mazerenderer.h"
+
+#include <QPainterPath>
+#include <QVector>
+#include <QPair>
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+
+// Tiled files are opened without decoding them, so only the tiles in view need decoding before they can be painted
+// (the rest are decoded on the worker thread meanwhile)
+void MazeRenderer::loadRegion(int startX, int startY, int endX, int endY) const
+{
+    uint32_t first[2] = { (uint32_t)startX, (uint32_t)startY };
+    uint32_t end[2] = { (uint32_t)endX, (uint32_t)endY };
+    Maze_loadRegion(maze, first, end);
+}
+
+void MazeRenderer::paintMaze(QPainter *painter, const QRect &rect) const
+{
+    if (inverse)
+        paintMazePaths(painter, rect);
+    else
+        paintMazeWalls(painter, rect);
+}
+
+void MazeRenderer::paintMazePaths(QPainter *painter, const QRect &rect) const
+{
+    QPainterPath mazePath;
+
+    // Convert from view coordinates into maze coordinates
+    int startX = ((rect.left()) / gridSpacing) - 1 - 1;
+    if (startX < 0)
+        startX = 0;
+
+    int startY = ((rect.top()) / gridSpacing) - 1 - 1;
+    if (startY < 0)
+        startY = 0;
+
+    int endX = (((rect.right())) / gridSpacing) + 1;
+    if (endX > mazeWidth)
+        endX = mazeWidth;
+
+    int endY = (((rect.bottom())) / gridSpacing) + 1;
+    if (endY > mazeHeight)
+        endY = mazeHeight;
+
+    loadRegion(startX, startY, endX, endY);
+
+    // Draw entrance and exit
+    mazePath.moveTo(((1) * gridSpacing), ((0) * gridSpacing));
+    mazePath.lineTo(((1) * gridSpacing), ((1) * gridSpacing));
+    mazePath.moveTo(((mazeWidth) * gridSpacing), ((mazeHeight) * gridSpacing));
+    mazePath.lineTo(((mazeWidth) * gridSpacing), ((mazeHeight + 1) * gridSpacing));
+
+    // Draw horizontal paths in the maze, one run of positions connected to the ones to their right at a time
+    BitArrayRef connected = maze->halls[0];
+    for (int y = startY; y < endY; ++y) {
+        MazeIndex rowStart = (MazeIndex)y * mazeWidth; // convert (x, y) coordinates into a scalar position
+        MazeIndex first = rowStart + startX, end;
+        while (BitArray_nextRun(connected, &first, &end, rowStart + endX, true)) {
+            int x = (int)(first - rowStart);
+            int offset = (int)(end - first) - 1;
+            mazePath.moveTo(((x + 1) * gridSpacing), ((y + 1) * gridSpacing));
+            mazePath.lineTo(((x + (offset + 1) + 1) * gridSpacing), ((y + 1) * gridSpacing));
+            first = end;
+        }
+    }
+
+    // Draw vertical paths in the maze
+    connected = maze->halls[1];
+    for (int x = startX; x < endX; ++x) {
+        for (int y = startY; y < endY; ++y) {
+            MazeIndex position = (MazeIndex)y * mazeWidth + x;
+            if (BitArray_readBit(connected, position)) { // are the position and the one next to it connected?
+                mazePath.moveTo(((x + 1) * gridSpacing), ((y + 1) * gridSpacing));
+                int offset = 0;
+                while (y + offset + 1 < endY) { // see if we can extend this line more
+                    position += mazeWidth; // move down one square
+                    if (BitArray_readBit(connected, position)) // are the position and the one next to it connected?
+                        offset++; // extend the endpoint of the line
+                    else
+                        break; // there is a wall, the line needs to end
+                }
+                mazePath.lineTo(((x + 1) * gridSpacing), ((y + (offset + 1) + 1) * gridSpacing));
+                y += offset; // if we were able to extend the line, adjust the index variable
+            }
+        }
+    }
+
+    QPen hallPen(Qt::black);
+    hallPen.setWidth(wallThickness);
+    if (roundCaps) {
+        hallPen.setCapStyle(Qt::RoundCap);
+        hallPen.setJoinStyle(Qt::RoundJoin);
+    } else {
+        hallPen.setCapStyle(Qt::SquareCap);
+        hallPen.setJoinStyle((Qt::MiterJoin));
+    }
+
+    painter->setPen(hallPen);
+    painter->drawPath(mazePath);
+}
+
+void MazeRenderer::paintMazeWalls(QPainter *painter, const QRect &rect) const
+{
+    QPainterPath mazePath;
+
+    // Convert from view coordinates into maze coordinates
+    int startX = ((rect.left()) / gridSpacing) - 1 - 1;
+    if (startX < 0)
+        startX = 0;
+
+    int startY = ((rect.top()) / gridSpacing) - 1 - 1;
+    if (startY < 0)
+        startY = 0;
+
+    int endX = (((rect.right())) / gridSpacing) + 1;
+    if (endX > mazeWidth)
+        endX = mazeWidth;
+
+    int endY = (((rect.bottom())) / gridSpacing) + 1;
+    if (endY > mazeHeight)
+        endY = mazeHeight;
+
+    loadRegion(startX, startY, endX, endY);
+
+    // Draw the border around the maze
+    mazePath.moveTo(0.5 * gridSpacing, 0.5 * gridSpacing);
+    mazePath.lineTo(0.5 * gridSpacing, (mazeHeight + 0.5) * gridSpacing);
+    mazePath.lineTo((mazeWidth - 1 + 0.5) * gridSpacing, (mazeHeight + 0.5) * gridSpacing);
+    mazePath.moveTo((mazeWidth + 0.5) * gridSpacing, (mazeHeight + 0.5) * gridSpacing);
+    mazePath.lineTo((mazeWidth + 0.5) * gridSpacing, 0.5 * gridSpacing);
+    mazePath.lineTo((1 + 0.5) * gridSpacing, 0.5 * gridSpacing);
+
+    // Draw vertical walls in the maze
+    BitArrayRef connected = maze->halls[0];
+    for (int x = startX; x < endX - 1; ++x) {
+        for (int y = startY; y < endY; ++y) {
+            MazeIndex position = (MazeIndex)y * mazeWidth + x; // convert (x, y) coordinates into a scalar position
+            if (!BitArray_readBit(connected, position)) { // are the position and the one next to it connected?
+                mazePath.moveTo(((x + 1.5) * gridSpacing), ((y + 0.5) * gridSpacing));
+                int offset = 0;
+                while (y + offset + 1 < endY) { // see if we can extend this line more
+                    position += mazeWidth; // move down one square
+                    if (!BitArray_readBit(connected, position)) // are the position and the one next to it connected?
+                        offset++; // extend the endpoint of the line
+                    else
+                        break; // there is a wall, the line needs to end
+                }
+                mazePath.lineTo(((x + 1.5) * gridSpacing), ((y + (offset + 1.5)) * gridSpacing));
+                y += offset; // if we were able to extend the line, adjust the index variable
+            }
+        }
+    }
+
+    // Draw horizontal walls in the maze, one run of positions that aren't connected to the ones below them at a time
+    connected = maze->halls[1];
+    for (int y = startY; y < endY - 1; ++y) {
+        MazeIndex rowStart = (MazeIndex)y * mazeWidth;
+        MazeIndex first = rowStart + startX, end;
+        while (BitArray_nextRun(connected, &first, &end, rowStart + endX, false)) {
+            int x = (int)(first - rowStart);
+            int offset = (int)(end - first) - 1;
+            mazePath.moveTo(((x + 0.5) * gridSpacing), ((y + 1.5) * gridSpacing));
+            mazePath.lineTo(((x + (offset + 1.5)) * gridSpacing), ((y + 1.5) * gridSpacing));
+            first = end;
+        }
+    }
+
+    QPen hallPen(Qt::black);
+    hallPen.setWidth(wallThickness);
+    if (roundCaps) {
+        hallPen.setCapStyle(Qt::RoundCap);
+        hallPen.setJoinStyle(Qt::RoundJoin);
+    } else {
+        hallPen.setCapStyle(Qt::SquareCap);
+        hallPen.setJoinStyle((Qt::MiterJoin));
+    }
+
+    painter->setPen(hallPen);
+    painter->drawPath(mazePath);
+}
+
+void MazeRenderer::paintSolution(QPainter *painter, const QRect &rect) const
+{
+    QPainterPath solutionPath;
+
+    // Convert from view coordinates into maze coordinates
+    int startX = ((rect.left()) / gridSpacing) - 1 - 1;
+    if (startX < 0)
+        startX = 0;
+
+    int startY = ((rect.top()) / gridSpacing) - 1 - 1;
+    if (startY < 0)
+        startY = 0;
+
+    int endX = (((rect.right())) / gridSpacing) + 1;
+    if (endX > mazeWidth)
+        endX = mazeWidth;
+
+    int endY = (((rect.bottom())) / gridSpacing) + 1;
+    if (endY > mazeHeight)
+        endY = mazeHeight;
+
+    loadRegion(startX, startY, endX, endY);
+
+    // Draw solution above entrance and exit
+    solutionPath.moveTo(((1) * gridSpacing), ((0) * gridSpacing));
+    solutionPath.lineTo(((1) * gridSpacing), ((1) * gridSpacing));
+    solutionPath.moveTo(((mazeWidth) * gridSpacing), ((mazeHeight) * gridSpacing));
+    solutionPath.lineTo(((mazeWidth) * gridSpacing), ((mazeHeight + 1) * gridSpacing));
+
+    // Draw horizontal paths in the solution, one run of positions connected to the ones to their right at a time
+    BitArrayRef connected = maze->solution[0];
+    for (int y = startY; y < endY; ++y) {
+        MazeIndex rowStart = (MazeIndex)y * mazeWidth; // convert (x, y) coordinates into a scalar position
+        MazeIndex first = rowStart + startX, end;
+        while (BitArray_nextRun(connected, &first, &end, rowStart + endX, true)) {
+            int x = (int)(first - rowStart);
+            int offset = (int)(end - first) - 1;
+            solutionPath.moveTo(((x + 1) * gridSpacing), ((y + 1) * gridSpacing));
+            solutionPath.lineTo(((x + (offset + 1) + 1) * gridSpacing), ((y + 1) * gridSpacing));
+            first = end;
+        }
+    }
+
+    // Draw vertical paths in the solution
+    connected = maze->solution[1];
+    for (int x = startX; x < endX; ++x) {
+        for (int y = startY; y < endY; ++y) {
+            MazeIndex position = (MazeIndex)y * mazeWidth + x;
+            if (BitArray_readBit(connected, position)) { // are the position and the one next to it connected?
+                solutionPath.moveTo(((x + 1) * gridSpacing), ((y + 1) * gridSpacing));
+                int offset = 0;
+                while (y + offset + 1 < endY) { // see if we can extend this line more
+                    position += mazeWidth; // move down one square
+                    if (BitArray_readBit(connected, position)) // are the position and the one next to it connected?
+                        offset++; // extend the endpoint of the line
+                    else
+                        break; // there is a wall, the line needs to end
+                }
+                solutionPath.lineTo(((x + 1) * gridSpacing), ((y + (offset + 1) + 1) * gridSpacing));
+                y += offset; // if we were able to extend the line, adjust the index variable
+            }
+        }
+    }
+
+    QPen solutionPen(Qt::red);
+    solutionPen.setWidth(solutionThickness);
+    if (roundCaps)
+        solutionPen.setCapStyle(Qt::RoundCap);
+    else
+        solutionPen.setCapStyle(Qt::SquareCap);
+
+    painter->setPen(solutionPen);
+    painter->drawPath(solutionPath);
+}
+
+static bool isWholePixels(qreal value)
+{
+    return value >= 1 && value == std::floor(value);
+}
+
+bool MazeRenderer::canRasterize(qreal scaling) const
+{
+    qreal spacing = gridSpacing * scaling;
+    if (antialiased || !isWholePixels(spacing) || spacing > MAZE_RASTER_MAX_SPACING)
+        return false;
+    // Round caps only look different from square ones once they are a few pixels across
+    for (qreal thickness : { wallThickness * scaling, solutionThickness * scaling })
+        if (!isWholePixels(thickness) || thickness > spacing || (roundCaps && thickness > 2))
+            return false;
+    return true;
+}
+
+// Every line a layer draws lies on the same lattice along both axes, spacing pixels apart. Lattice index 2k is line k,
+// which covers thickness pixels from first + k * spacing, and 2k + 1 is the gap between line k and line k + 1. Since
+// every pixel of a lattice row is drawn the same way, each row only needs working out once, however many pixels tall
+// it is.
+struct RasterLattice
+{
+    int first;
+    int spacing;
+    int thickness;
+
+    int indexAt(int pixel) const {
+        int offset = pixel - first;
+        int k = (offset >= 0) ? offset / spacing : -((spacing - 1 - offset) / spacing);
+        return (offset - k * spacing < thickness) ? 2 * k : 2 * k + 1;
+    }
+
+    int pixelAt(int index) const {
+        int k = (index >= 0) ? index / 2 : -((1 - index) / 2);
+        return first + k * spacing + ((index & 1) ? thickness : 0);
+    }
+};
+
+// Whether the line at lattice index (lx, ly) is drawn. Walls lie on the lines between cells, where line 0 is the
+// border, and paths lie on the lines through the centers of the cells. Where lines cross, the crossing is drawn if any
+// line into it is, as square caps do.
+bool MazeRenderer::isLineSet(bool walls, BitArrayRef *bitmaps, int lx, int ly) const
+{
+    bool vertical = !(lx & 1);
+    bool horizontal = !(ly & 1);
+    if (vertical && horizontal)
+        return isLineSet(walls, bitmaps, lx, ly - 1) || isLineSet(walls, bitmaps, lx, ly + 1) ||
+               isLineSet(walls, bitmaps, lx - 1, ly) || isLineSet(walls, bitmaps, lx + 1, ly);
+    if (!vertical && !horizontal)
+        return false;
+
+    // The line, and the gap it spans
+    int i = vertical ? lx / 2 : (lx - 1) / 2;
+    int j = horizontal ? ly / 2 : (ly - 1) / 2;
+    if (lx < 0 || ly < -1 || i > mazeWidth || j > mazeHeight)
+        return false;
+    if (walls) {
+        if (vertical) {
+            if (j < 0 || j >= mazeHeight)
+                return false;
+            if (i == 0 || i == mazeWidth)
+                return true; // the border
+            return !BitArray_readBit(bitmaps[0], (MazeIndex)j * mazeWidth + i - 1);
+        }
+        if (i >= mazeWidth || j < 0)
+            return false;
+        if (j == 0)
+            return i != 0; // the border, open at the entrance
+        if (j == mazeHeight)
+            return i != mazeWidth - 1; // and at the exit
+        return !BitArray_readBit(bitmaps[1], (MazeIndex)(j - 1) * mazeWidth + i);
+    }
+    if (vertical) {
+        if (i >= mazeWidth)
+            return false;
+        if (j == -1)
+            return i == 0; // the entrance
+        if (j == mazeHeight - 1)
+            return i == mazeWidth - 1; // the exit
+        return j < mazeHeight && BitArray_readBit(bitmaps[1], (MazeIndex)j * mazeWidth + i);
+    }
+    if (i >= mazeWidth - 1 || j < 0 || j >= mazeHeight)
+        return false;
+    return BitArray_readBit(bitmaps[0], (MazeIndex)j * mazeWidth + i);
+}
+
+// Sets the pixels from first up to end of a scanline to color, or for indexed formats, to index
+static void fillRun(uchar *line, QImage::Format format, int first, int end, QRgb color, int index)
+{
+    if (format == QImage::Format_Indexed8) {
+        memset(line + first, index, end - first);
+    } else if (format == QImage::Format_Mono) {
+        // The most significant bit is the leftmost pixel, so whole bytes in the middle of the run can be set at once
+        int x = first;
+        for (; x < end && (x & 7); ++x)
+            line[x >> 3] = index ? (line[x >> 3] | (0x80 >> (x & 7))) : (line[x >> 3] & ~(0x80 >> (x & 7)));
+        int bytes = (end - x) / 8;
+        memset(line + (x >> 3), index ? 0xFF : 0x00, bytes);
+        for (x += 8 * bytes; x < end; ++x)
+            line[x >> 3] = index ? (line[x >> 3] | (0x80 >> (x & 7))) : (line[x >> 3] & ~(0x80 >> (x & 7)));
+    } else {
+        std::fill((QRgb*)line + first, (QRgb*)line + end, color);
+    }
+}
+
+bool MazeRenderer::rasterize(QImage *image, const QPoint &origin, qreal scaling, int thickness, bool walls, BitArrayRef *bitmaps, QRgb color) const
+{
+    if (!maze || !canRasterize(scaling))
+        return false;
+    QImage::Format format = image->format();
+    int index = -1;
+    if (format == QImage::Format_Indexed8 || format == QImage::Format_Mono) {
+        index = image->colorTable().indexOf(color);
+        if (index < 0)
+            return false;
+    } else if (format != QImage::Format_ARGB32_Premultiplied) {
+        return false;
+    }
+
+    // QPainter's aliased lines cover the pixels whose centers lie within half the pen's width of them, rounding
+    // down and to the right
+    RasterLattice lattice;
+    lattice.spacing = (int)(gridSpacing * scaling);
+    lattice.thickness = (int)(thickness * scaling);
+    lattice.first = (int)std::floor((walls ? 0.5 : 1.0) * lattice.spacing - lattice.thickness / 2.0 + 0.5);
+
+    int left = origin.x();
+    int right = origin.x() + image->width();
+    int bottom = origin.y() + image->height();
+    loadRegion(qBound(0, left / lattice.spacing - 2, mazeWidth), qBound(0, origin.y() / lattice.spacing - 2, mazeHeight),
+               qBound(0, right / lattice.spacing + 2, mazeWidth), qBound(0, bottom / lattice.spacing + 2, mazeHeight));
+
+    QVector<QPair<int, int>> runs; // the pixels from first up to second in each row of the lattice row are drawn
+    for (int y = origin.y(); y < bottom;) {
+        int ly = lattice.indexAt(y);
+        runs.clear();
+        for (int lx = lattice.indexAt(left); lattice.pixelAt(lx) < right; ++lx) {
+            if (!isLineSet(walls, bitmaps, lx, ly))
+                continue;
+            int from = qMax(lattice.pixelAt(lx), left);
+            int to = qMin(lattice.pixelAt(lx + 1), right);
+            if (!runs.isEmpty() && runs.last().second == from)
+                runs.last().second = to;
+            else if (from < to)
+                runs.append(qMakePair(from, to));
+        }
+
+        for (int rowEnd = qMin(lattice.pixelAt(ly + 1), bottom); y < rowEnd; ++y) {
+            uchar *line = image->scanLine(y - origin.y());
+            for (const QPair<int, int> &run : runs)
+                fillRun(line, format, run.first - left, run.second - left, color, index);
+        }
+    }
+    return true;
+}
+
+bool MazeRenderer::rasterizeMaze(QImage *image, const QPoint &origin, qreal scaling) const
+{
+    return maze && rasterize(image, origin, scaling, wallThickness, !inverse, maze->halls, qRgb(0, 0, 0));
+}
+
+bool MazeRenderer::rasterizeSolution(QImage *image, const QPoint &origin, qreal scaling) const
+{
+    return maze && rasterize(image, origin, scaling, solutionThickness, false, maze->solution, qRgb(255, 0, 0));
+}
+
+QImage::Format MazeRenderer::imageFormat(bool showMaze, bool showSolution) const
+{
+    if (antialiased)
+        return QImage::Format_ARGB32_Premultiplied;
+    return (showMaze && showSolution) ? QImage::Format_Indexed8 : QImage::Format_Mono;
+}
+
+QVector<QRgb> MazeRenderer::imageColors(bool showMaze, bool showSolution) const
+{
+    if (imageFormat(showMaze, showSolution) == QImage::Format_ARGB32_Premultiplied)
+        return QVector<QRgb>();
+    QVector<QRgb> colors;
+    colors.append(qRgb(255, 255, 255)); // white first, so a cleared image is blank
+    if (showMaze || !showSolution)
+        colors.append(qRgb(0, 0, 0));
+    if (showSolution)
+        colors.append(qRgb(255, 0, 0));
+    return colors;
+}
+
+void MazeRenderer::renderImage(QImage *image, const QPoint &origin, qreal scaling, bool showMaze, bool showSolution) const
+{
+    image->fill(Qt::white);
+    if (canRasterize(scaling)) {
+        if (showMaze)
+            rasterizeMaze(image, origin, scaling);
+        if (showSolution)
+            rasterizeSolution(image, origin, scaling);
+        return;
+    }
+
+    // QPainter can't draw into indexed images, so the lines are drawn in color first, and then looked up in the color
+    // table, where without antialiasing every pixel is one of its colors exactly
+    if (image->format() != QImage::Format_ARGB32_Premultiplied) {
+        QImage drawn(image->size(), QImage::Format_ARGB32_Premultiplied);
+        if (drawn.isNull())
+            return;
+        renderImage(&drawn, origin, scaling, showMaze, showSolution);
+        QVector<QRgb> colors = image->colorTable();
+        for (int y = 0; y < image->height(); ++y) {
+            const QRgb *pixels = (const QRgb*)drawn.constScanLine(y);
+            uchar *line = image->scanLine(y);
+            for (int x = 0; x < image->width();) {
+                int run = x;
+                while (run < image->width() && pixels[run] == pixels[x])
+                    ++run;
+                int index = colors.indexOf(pixels[x]);
+                if (index > 0) // it's white already
+                    fillRun(line, image->format(), x, run, pixels[x], index);
+                x = run;
+            }
+        }
+        return;
+    }
+
+    QPainter painter;
+    if (!painter.begin(image))
+        return;
+    painter.translate(-origin.x(), -origin.y());
+    painter.scale(scaling, scaling);
+    if (antialiased)
+        painter.setRenderHint(QPainter::Antialiasing);
+    QRect rect = painter.worldTransform().inverted().mapRect(QRect(origin, image->size()));
+    if (showMaze)
+        paintMaze(&painter, rect);
+    if (showSolution)
+        paintSolution(&painter, rect);
+    painter.end();
+}
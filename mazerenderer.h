@@ -0,0 +1,69 @@
+/*
+ *  mazerenderer.h
+ *  MazeGenerator
+ *
+ *  Copyright 2018-2024 Matthew T. Pandina. All rights reserved.
+ *
+ */
+
+#ifndef MAZERENDERER_H
+#define MAZERENDERER_H
+
+#include <QPainter>
+#include <QImage>
+#include <QRect>
+#include <QVector>
+
+#include "Maze.h"
+
+#define MAZE_RASTER_MAX_SPACING 8 // the largest grid spacing, in pixels, that is drawn straight into an image's pixels
+
+// Draws a maze the way MazeWidget shows it. It holds a copy of the widget's style rather than a pointer to the widget,
+// so any number of copies may draw the same maze at once on any thread, as long as the maze isn't generated, opened or
+// deleted meanwhile. Rects are in maze coordinates, before scaling.
+class MazeRenderer
+{
+public:
+    MazeRef maze = 0;
+    int mazeWidth = 0;
+    int mazeHeight = 0;
+
+    int gridSpacing = 0;
+    int wallThickness = 0;
+    int solutionThickness = 0;
+    bool roundCaps = true;
+    bool antialiased = false;
+    bool inverse = false;
+
+    void paintMaze(QPainter *painter, const QRect &rect) const;
+    void paintMazePaths(QPainter *painter, const QRect &rect) const;
+    void paintMazeWalls(QPainter *painter, const QRect &rect) const;
+    void paintSolution(QPainter *painter, const QRect &rect) const;
+
+    // Whether the rasterize functions can draw at this scaling: without antialiasing, where the grid spacing and
+    // thicknesses come to whole pixels, and the grid spacing to no more than MAZE_RASTER_MAX_SPACING of them
+    bool canRasterize(qreal scaling) const;
+
+    // Draw the same pixels as the paint functions, but straight into image (in ARGB32_Premultiplied, or Indexed8 or Mono
+    // with the color in its color table), whose top left is at origin in the scaled widget's pixels, rather than
+    // building a path of every hall. Return false, having drawn nothing, unless canRasterize().
+    bool rasterizeMaze(QImage *image, const QPoint &origin, qreal scaling) const;
+    bool rasterizeSolution(QImage *image, const QPoint &origin, qreal scaling) const;
+
+    // The smallest format, and its colors, that an exported image can be drawn in: Mono when only black (or red) is
+    // drawn on white, Indexed8 for all three, and ARGB32_Premultiplied when antialiasing blends them
+    QImage::Format imageFormat(bool showMaze, bool showSolution) const;
+    QVector<QRgb> imageColors(bool showMaze, bool showSolution) const;
+
+    // Draws the maze on white as an exported image shows it, into image (in imageFormat(), with imageColors()), whose
+    // top left is at origin in the scaled widget's pixels. Each band of a larger image may be drawn on its own, on any
+    // thread.
+    void renderImage(QImage *image, const QPoint &origin, qreal scaling, bool showMaze, bool showSolution) const;
+
+private:
+    void loadRegion(int startX, int startY, int endX, int endY) const;
+    bool isLineSet(bool walls, BitArrayRef *bitmaps, int lx, int ly) const;
+    bool rasterize(QImage *image, const QPoint &origin, qreal scaling, int thickness, bool walls, BitArrayRef *bitmaps, QRgb color) const;
+};
+
+#endif // MAZERENDERER_H
@@ -0,0 +1,172 @@
+/*
+ *  mazetilecache.cpp
+ *  MazeGenerator
+ *
+ *  Copyright 2018-2024 Matthew T. Pandina. All rights reserved.
+ *
+ */
+
+#include "mazetilecache.h"
+
+#include <QRunnable>
+#include <QPainter>
+#include <QMetaObject>
+
+class MazeTileJob : public QRunnable
+{
+public:
+    MazeTileJob(MazeTileCache *cache, const MazeTileKey &key, quint64 generation, const MazeRenderer &renderer)
+        : cache(cache), key(key), generation(generation), renderer(renderer)
+    {
+
+    }
+
+    // QThreadPool::clear() deletes the jobs that haven't started, on the GUI thread, so they stop being pending
+    ~MazeTileJob() override {
+        if (!started)
+            cache->pending.remove(key);
+    }
+
+    void run() override {
+        started = true;
+
+        QImage image(MAZE_TILE_SIZE, MAZE_TILE_SIZE, QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+
+        // Drawn exactly as MazeWidget::paintEvent() would draw this part of the widget
+        QPoint origin(key.column * MAZE_TILE_SIZE, key.row * MAZE_TILE_SIZE);
+        bool rasterized = (key.layer == MazeTileCache::MazeLayer) ? renderer.rasterizeMaze(&image, origin, key.scaling) : renderer.rasterizeSolution(&image, origin, key.scaling);
+        if (!rasterized) {
+            QPainter painter;
+            painter.begin(&image);
+            painter.translate(-origin.x(), -origin.y());
+            painter.scale(key.scaling, key.scaling);
+            if (renderer.antialiased)
+                painter.setRenderHint(QPainter::Antialiasing);
+            QRect rect = painter.worldTransform().inverted().mapRect(QRect(origin, QSize(MAZE_TILE_SIZE, MAZE_TILE_SIZE)));
+            if (key.layer == MazeTileCache::MazeLayer)
+                renderer.paintMaze(&painter, rect);
+            else
+                renderer.paintSolution(&painter, rect);
+            painter.end();
+        }
+
+        // Pixmaps may only be made on the GUI thread, and this job is deleted as soon as it returns
+        MazeTileCache *owner = cache;
+        MazeTileKey tileKey = key;
+        quint64 tileGeneration = generation;
+        QMetaObject::invokeMethod(owner, [owner, tileKey, tileGeneration, image]() { owner->tileDrawn(tileKey, tileGeneration, image); }, Qt::QueuedConnection);
+    }
+
+private:
+    MazeTileCache *cache;
+    MazeTileKey key;
+    quint64 generation;
+    MazeRenderer renderer;
+    bool started = false;
+};
+
+MazeTileCache::MazeTileCache(QObject *parent) : QObject(parent)
+{
+    tiles.setMaxCost(MAZE_TILE_CACHE_KB);
+}
+
+MazeTileCache::~MazeTileCache()
+{
+    releaseMaze();
+}
+
+void MazeTileCache::releaseMaze()
+{
+    pool.clear();
+    pool.waitForDone();
+    invalidate(AllLayers);
+}
+
+int MazeTileCache::layerIndex(int layer) const
+{
+    return (layer == MazeLayer) ? 0 : 1;
+}
+
+void MazeTileCache::invalidate(int layers)
+{
+    pool.clear();
+    for (int layer : { MazeLayer, SolutionLayer }) {
+        if (!(layers & layer))
+            continue;
+        generations[layerIndex(layer)]++;
+        for (const MazeTileKey &key : tiles.keys())
+            if (key.layer == layer)
+                tiles.remove(key);
+        QMutableSetIterator<MazeTileKey> i(pending);
+        while (i.hasNext())
+            if (i.next().layer == layer)
+                i.remove();
+    }
+}
+
+QRect MazeTileCache::tileRect(const MazeTileKey &key) const
+{
+    return QRect(key.column * MAZE_TILE_SIZE, key.row * MAZE_TILE_SIZE, MAZE_TILE_SIZE, MAZE_TILE_SIZE);
+}
+
+// The columns and rows of the tiles that cover rect, clipped to the widget
+QRect MazeTileCache::tilesOf(const QRect &rect, const MazeRenderer &renderer, qreal scaling) const
+{
+    QRect widgetRect(0, 0, ((renderer.mazeWidth + 1) * renderer.gridSpacing) * scaling, ((renderer.mazeHeight + 1) * renderer.gridSpacing) * scaling);
+    QRect clipped = rect.intersected(widgetRect);
+    if (clipped.isEmpty())
+        return QRect();
+    return QRect(QPoint(clipped.left() / MAZE_TILE_SIZE, clipped.top() / MAZE_TILE_SIZE), QPoint(clipped.right() / MAZE_TILE_SIZE, clipped.bottom() / MAZE_TILE_SIZE));
+}
+
+QRegion MazeTileCache::paint(QPainter *painter, const QRect &rect, Layer layer, const MazeRenderer &renderer, qreal scaling)
+{
+    QRegion missing(rect);
+    QRect columnsAndRows = tilesOf(rect, renderer, scaling);
+    for (int row = columnsAndRows.top(); row <= columnsAndRows.bottom(); ++row) {
+        for (int column = columnsAndRows.left(); column <= columnsAndRows.right(); ++column) {
+            MazeTileKey key = { layer, column, row, scaling };
+            QPixmap *pixmap = tiles.object(key);
+            if (!pixmap)
+                continue;
+            QRect drawn = tileRect(key).intersected(rect);
+            painter->drawPixmap(drawn.topLeft(), *pixmap, drawn.translated(-tileRect(key).topLeft()));
+            missing -= drawn;
+        }
+    }
+    return missing;
+}
+
+void MazeTileCache::prefetch(const QRect &rect, int layers, const MazeRenderer &renderer, qreal scaling)
+{
+    // Tiles still waiting for a thread are for a view that may have scrolled away by now
+    pool.clear();
+
+    if (!renderer.maze)
+        return;
+    QRect visible = tilesOf(rect, renderer, scaling);
+    QRect columnsAndRows = tilesOf(rect.adjusted(-MAZE_TILE_SIZE, -MAZE_TILE_SIZE, MAZE_TILE_SIZE, MAZE_TILE_SIZE), renderer, scaling);
+    for (int layer : { MazeLayer, SolutionLayer }) {
+        if (!(layers & layer))
+            continue;
+        for (int row = columnsAndRows.top(); row <= columnsAndRows.bottom(); ++row) {
+            for (int column = columnsAndRows.left(); column <= columnsAndRows.right(); ++column) {
+                MazeTileKey key = { layer, column, row, scaling };
+                if (tiles.contains(key) || pending.contains(key))
+                    continue;
+                pending.insert(key);
+                pool.start(new MazeTileJob(this, key, generations[layerIndex(layer)], renderer), visible.contains(column, row) ? 1 : 0);
+            }
+        }
+    }
+}
+
+void MazeTileCache::tileDrawn(const MazeTileKey &key, quint64 generation, const QImage &image)
+{
+    // The layer has been invalidated since this tile started drawing
+    if (generation != generations[layerIndex(key.layer)])
+        return;
+    pending.remove(key);
+    tiles.insert(key, new QPixmap(QPixmap::fromImage(image)), (MAZE_TILE_SIZE * MAZE_TILE_SIZE * 4) / 1024);
+}
@@ -0,0 +1,87 @@
+/*
+ *  mazetilecache.h
+ *  MazeGenerator
+ *
+ *  Copyright 2018-2024 Matthew T. Pandina. All rights reserved.
+ *
+ */
+
+#ifndef MAZETILECACHE_H
+#define MAZETILECACHE_H
+
+#include <QObject>
+#include <QCache>
+#include <QSet>
+#include <QImage>
+#include <QPixmap>
+#include <QRegion>
+#include <QThreadPool>
+
+#include "mazerenderer.h"
+
+#define MAZE_TILE_SIZE 256 // pixels along each side of a tile
+#define MAZE_TILE_CACHE_KB (256 * 1024) // how much memory the tiles of every layer and zoom level may take together
+
+struct MazeTileKey
+{
+    int layer;
+    int column; // in tiles, from the top left of the widget
+    int row;
+    qreal scaling; // tiles drawn at each zoom level are kept apart, so zooming back in finds them still there
+
+    bool operator==(const MazeTileKey &other) const {
+        return layer == other.layer && column == other.column && row == other.row && scaling == other.scaling;
+    }
+};
+
+inline size_t qHash(const MazeTileKey &key, size_t seed = 0)
+{
+    return qHash(key.layer, seed) ^ (qHash(key.column, seed) * 31) ^ (qHash(key.row, seed) * 1031) ^ (qHash(key.scaling, seed) * 65537);
+}
+
+// Draws MazeWidget a tile at a time on a pool of background threads, and keeps the tiles as pixmaps, so repainting
+// (while scrolling, say) blits them instead of building every hall of the view into a QPainterPath again. The maze
+// and its solution are drawn into separate layers, so a change to one doesn't throw the other away.
+class MazeTileCache : public QObject
+{
+    Q_OBJECT
+public:
+    enum Layer {
+        MazeLayer = 1,
+        SolutionLayer = 2,
+        AllLayers = MazeLayer | SolutionLayer,
+    };
+
+    explicit MazeTileCache(QObject *parent = nullptr);
+    ~MazeTileCache();
+
+    // Waits for any tiles being drawn, and forgets every tile. Must be called before the maze being drawn is generated
+    // again, opened over, or deleted.
+    void releaseMaze();
+
+    // Forgets the tiles of the given layers, once the style they are drawn in has changed
+    void invalidate(int layers);
+
+    // Blits the tiles of layer that are ready over rect (in pixels, with no scaling on painter), and returns the part of
+    // rect that still needs to be drawn some other way
+    QRegion paint(QPainter *painter, const QRect &rect, Layer layer, const MazeRenderer &renderer, qreal scaling);
+
+    // Starts drawing the tiles of the given layers that aren't ready yet, covering rect (which should be everything in
+    // view) first, and then a ring of tiles around it. Tiles still waiting to be drawn for an earlier call are dropped.
+    void prefetch(const QRect &rect, int layers, const MazeRenderer &renderer, qreal scaling);
+
+private:
+    void tileDrawn(const MazeTileKey &key, quint64 generation, const QImage &image);
+    QRect tileRect(const MazeTileKey &key) const;
+    QRect tilesOf(const QRect &rect, const MazeRenderer &renderer, qreal scaling) const;
+    int layerIndex(int layer) const;
+
+    QThreadPool pool;
+    QCache<MazeTileKey, QPixmap> tiles;
+    QSet<MazeTileKey> pending; // tiles that are being drawn, or waiting to be
+    quint64 generations[2] = { 0, 0 }; // changed whenever a layer is invalidated, so tiles drawn before that are dropped
+
+    friend class MazeTileJob;
+};
+
+#endif // MAZETILECACHE_H
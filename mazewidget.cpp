@@ -11,6 +11,9 @@
 #include "deletemazeworker.h"
 #include "openmazeworker.h"
 #include "savemazeworker.h"
+#include "mazetilecache.h"
+#include "buildpyramidworker.h"
+#include "exportimageworker.h"
 
 #include <QPaintEvent>
 #include <QPainter>
@@ -34,6 +37,8 @@ MazeWidget::MazeWidget(QWidget *parent) : QWidget(parent)
 MazeWidget::~MazeWidget()
 {
     // Ensure free() gets called from the same thread that malloc did, though the app may exit before this can happen
+    tileCache.releaseMaze();
+    releasePyramid();
     DeleteMazeWorker *worker = new DeleteMazeWorker(myMaze);
     worker->moveToThread(&workerThread);
     connect(worker, &DeleteMazeWorker::deleteMazeWorker_error, this, &MazeWidget::deleteMazeWorker_error);
@@ -49,6 +54,8 @@ MazeWidget::~MazeWidget()
 void MazeWidget::generateMaze()
 {
     creatingMaze = true;
+    tileCache.releaseMaze();
+    releasePyramid();
 
     GenerateMazeWorker *worker = new GenerateMazeWorker(myMaze, mazeWidth, mazeHeight);
     myMaze = 0; // clear our copy
@@ -57,6 +64,7 @@ void MazeWidget::generateMaze()
     connect(worker, &GenerateMazeWorker::generateMazeWorker_error, this, &MazeWidget::generateMazeWorker_error);
     connect(worker, &GenerateMazeWorker::generateMazeWorker_finished, this, &MazeWidget::generateMazeWorker_finished);
     connect(worker, &GenerateMazeWorker::generateMazeWorker_finished, worker, &GenerateMazeWorker::deleteLater);
+    connect(worker, &GenerateMazeWorker::generateMazeWorker_error, worker, &GenerateMazeWorker::deleteLater);
 
     // For progress indicators
     connect(worker, &GenerateMazeWorker::generateMazeWorker_deletingOldMaze, this, &MazeWidget::generateMazeWorker_deletingOldMaze);
@@ -78,6 +86,8 @@ void MazeWidget::openMaze()
         return;
 
     creatingMaze = true;
+    tileCache.releaseMaze();
+    releasePyramid();
 
     OpenMazeWorker *worker = new OpenMazeWorker(myMaze, fileName);
     myMaze = 0; // clear our copy
@@ -99,8 +109,44 @@ void MazeWidget::openMaze()
     update();
 }
 
+// Builds the overview pyramid of a maze that has just been generated or opened, on the worker thread
+void MazeWidget::buildPyramid()
+{
+    if (!myMaze)
+        return;
+
+    BuildPyramidWorker *worker = new BuildPyramidWorker(myMaze);
+    worker->moveToThread(&workerThread);
+    connect(worker, &BuildPyramidWorker::buildPyramidWorker_finished, this, &MazeWidget::buildPyramidWorker_finished);
+    connect(worker, &BuildPyramidWorker::buildPyramidWorker_finished, worker, &BuildPyramidWorker::deleteLater);
+    connect(this, &MazeWidget::buildPyramidWorker_start, worker, &BuildPyramidWorker::process);
+    emit buildPyramidWorker_start();
+}
+
+void MazeWidget::releasePyramid()
+{
+    delete pyramid;
+    pyramid = 0;
+}
+
+void MazeWidget::buildPyramidWorker_finished(void *maze, void *pyramid)
+{
+    // Another maze may have been asked for since this one's pyramid was started
+    if (creatingMaze || (MazeRef)maze != myMaze) {
+        delete (MazePyramid*)pyramid;
+        return;
+    }
+    releasePyramid();
+    this->pyramid = (MazePyramid*)pyramid;
+    update();
+}
+
 void MazeWidget::resetWidgetSize()
 {
+    // 64-bit builds allow mazes larger than Qt allows a widget to be, so zoom out until the widget fits
+    while ((qMax(mazeWidth, mazeHeight) + 1.0) * gridSpacing * scaling > QWIDGETSIZE_MAX)
+        scaling /= 2.0;
+
     setMinimumWidth((mazeWidth + 1) * gridSpacing * scaling);
     setMaximumWidth((mazeWidth + 1) * gridSpacing * scaling);
     setMinimumHeight((mazeHeight + 1) * gridSpacing * scaling);
@@ -132,7 +178,7 @@ bool MazeWidget::getSavingMaze() const
     return savingMaze;
 }
 
-uint32_t MazeWidget::getSolutionLength() const
+MazeIndex MazeWidget::getSolutionLength() const
 {
     return solutionLength;
 }
@@ -145,6 +191,7 @@ bool MazeWidget::getInverse() const
 void MazeWidget::setInverse(bool value)
 {
     inverse = value;
+    tileCache.invalidate(MazeTileCache::MazeLayer);
     update();
 }
 
@@ -156,9 +203,25 @@ bool MazeWidget::getAntialiased() const
 void MazeWidget::setAntialiased(bool value)
 {
     antialiased = value;
+    tileCache.invalidate(MazeTileCache::AllLayers);
     update();
 }
 
+MazeRenderer MazeWidget::renderer() const
+{
+    MazeRenderer mazeRenderer;
+    mazeRenderer.maze = myMaze;
+    mazeRenderer.mazeWidth = mazeWidth;
+    mazeRenderer.mazeHeight = mazeHeight;
+    mazeRenderer.gridSpacing = gridSpacing;
+    mazeRenderer.wallThickness = wallThickness;
+    mazeRenderer.solutionThickness = solutionThickness;
+    mazeRenderer.roundCaps = roundCaps;
+    mazeRenderer.antialiased = antialiased;
+    mazeRenderer.inverse = inverse;
+    return mazeRenderer;
+}
+
 QRect MazeWidget::scaleRect(const QRect &rect)
 {
     if (scaling >= 1.0)
@@ -207,176 +270,18 @@ void MazeWidget::paintPathBackground(QPainter *painter, const QRect &rect)
 
 void MazeWidget::paintMazePaths(QPainter *painter, const QRect &rect)
 {
-    if (creatingMaze) // make safe for something external to call
+    if (creatingMaze || !myMaze) // make safe for something external to call
         return;
 
-    QPainterPath mazePath;
-
-    // Convert from view coordinates into maze coordinates
-    int startX = ((rect.left()) / gridSpacing) - 1 - 1;
-    if (startX < 0)
-        startX = 0;
-
-    int startY = ((rect.top()) / gridSpacing) - 1 - 1;
-    if (startY < 0)
-        startY = 0;
-
-    int endX = (((rect.right())) / gridSpacing) + 1;
-    if (endX > mazeWidth)
-        endX = mazeWidth;
-
-    int endY = (((rect.bottom())) / gridSpacing) + 1;
-    if (endY > mazeHeight)
-        endY = mazeHeight;
-
-    // Draw entrance and exit
-    mazePath.moveTo(((1) * gridSpacing), ((0) * gridSpacing));
-    mazePath.lineTo(((1) * gridSpacing), ((1) * gridSpacing));
-    mazePath.moveTo(((mazeWidth) * gridSpacing), ((mazeHeight) * gridSpacing));
-    mazePath.lineTo(((mazeWidth) * gridSpacing), ((mazeHeight + 1) * gridSpacing));
-
-    // Draw horizontal paths in the maze
-    BitArrayRef connected = myMaze->halls[0];
-    for (int y = startY; y < endY; ++y) {
-        for (int x = startX; x < endX; ++x) {
-            uint32_t position = y * mazeWidth + x; // convert (x, y) coordinates into a scalar position
-            if (BitArray_readBit(connected, position)) { // are the position and the one next to it connected?
-                mazePath.moveTo(((x + 1) * gridSpacing), ((y + 1) * gridSpacing));
-                int offset = 0;
-                while (x + offset + 1 < endX) { // see if we can extend this line more
-                    position++; // move to the right one square
-                    if (BitArray_readBit(connected, position)) // are the position and the one next to it connected?
-                        offset++; // extend the endpoint of the line
-                    else
-                        break; // there is a wall, the line needs to end
-                }
-                mazePath.lineTo(((x + (offset + 1) + 1) * gridSpacing), ((y + 1) * gridSpacing));
-                x += offset; // if we were able to extend the line, adjust the index variable
-            }
-        }
-    }
-
-    // Draw vertical paths in the maze
-    connected = myMaze->halls[1];
-    for (int x = startX; x < endX; ++x) {
-        for (int y = startY; y < endY; ++y) {
-            uint32_t position = y * mazeWidth + x;
-            if (BitArray_readBit(connected, position)) { // are the position and the one next to it connected?
-                mazePath.moveTo(((x + 1) * gridSpacing), ((y + 1) * gridSpacing));
-                int offset = 0;
-                while (y + offset + 1 < endY) { // see if we can extend this line more
-                    position += mazeWidth; // move down one square
-                    if (BitArray_readBit(connected, position)) // are the position and the one next to it connected?
-                        offset++; // extend the endpoint of the line
-                    else
-                        break; // there is a wall, the line needs to end
-                }
-                mazePath.lineTo(((x + 1) * gridSpacing), ((y + (offset + 1) + 1) * gridSpacing));
-                y += offset; // if we were able to extend the line, adjust the index variable
-            }
-        }
-    }
-
-    QPen hallPen(Qt::black);
-    hallPen.setWidth(wallThickness);
-    if (roundCaps) {
-        hallPen.setCapStyle(Qt::RoundCap);
-        hallPen.setJoinStyle(Qt::RoundJoin);
-    } else {
-        hallPen.setCapStyle(Qt::SquareCap);
-        hallPen.setJoinStyle((Qt::MiterJoin));
-    }
-
-    painter->setPen(hallPen);
-    painter->drawPath(mazePath);
+    renderer().paintMazePaths(painter, rect);
 }
 
 void MazeWidget::paintMazeWalls(QPainter *painter, const QRect &rect)
 {
-    if (creatingMaze) // make safe for something external to call
+    if (creatingMaze || !myMaze) // make safe for something external to call
         return;
 
-    QPainterPath mazePath;
-
-    // Convert from view coordinates into maze coordinates
-    int startX = ((rect.left()) / gridSpacing) - 1 - 1;
-    if (startX < 0)
-        startX = 0;
-
-    int startY = ((rect.top()) / gridSpacing) - 1 - 1;
-    if (startY < 0)
-        startY = 0;
-
-    int endX = (((rect.right())) / gridSpacing) + 1;
-    if (endX > mazeWidth)
-        endX = mazeWidth;
-
-    int endY = (((rect.bottom())) / gridSpacing) + 1;
-    if (endY > mazeHeight)
-        endY = mazeHeight;
-
-    // Draw the border around the maze
-    mazePath.moveTo(0.5 * gridSpacing, 0.5 * gridSpacing);
-    mazePath.lineTo(0.5 * gridSpacing, (mazeHeight + 0.5) * gridSpacing);
-    mazePath.lineTo((mazeWidth - 1 + 0.5) * gridSpacing, (mazeHeight + 0.5) * gridSpacing);
-    mazePath.moveTo((mazeWidth + 0.5) * gridSpacing, (mazeHeight + 0.5) * gridSpacing);
-    mazePath.lineTo((mazeWidth + 0.5) * gridSpacing, 0.5 * gridSpacing);
-    mazePath.lineTo((1 + 0.5) * gridSpacing, 0.5 * gridSpacing);
-
-    // Draw vertical walls in the maze
-    BitArrayRef connected = myMaze->halls[0];
-    for (int x = startX; x < endX - 1; ++x) {
-        for (int y = startY; y < endY; ++y) {
-            uint32_t position = y * mazeWidth + x; // convert (x, y) coordinates into a scalar position
-            if (!BitArray_readBit(connected, position)) { // are the position and the one next to it connected?
-                mazePath.moveTo(((x + 1.5) * gridSpacing), ((y + 0.5) * gridSpacing));
-                int offset = 0;
-                while (y + offset + 1 < endY) { // see if we can extend this line more
-                    position += mazeWidth; // move down one square
-                    if (!BitArray_readBit(connected, position)) // are the position and the one next to it connected?
-                        offset++; // extend the endpoint of the line
-                    else
-                        break; // there is a wall, the line needs to end
-                }
-                mazePath.lineTo(((x + 1.5) * gridSpacing), ((y + (offset + 1.5)) * gridSpacing));
-                y += offset; // if we were able to extend the line, adjust the index variable
-            }
-        }
-    }
-
-    // Draw horizontal walls in the maze
-    connected = myMaze->halls[1];
-    for (int y = startY; y < endY - 1; ++y) {
-        for (int x = startX; x < endX; ++x) {
-            uint32_t position = y * mazeWidth + x;
-            if (!BitArray_readBit(connected, position)) { // are the position and the one next to it connected?
-                mazePath.moveTo(((x + 0.5) * gridSpacing), ((y + 1.5) * gridSpacing));
-                int offset = 0;
-                while (x + offset + 1 < endX) { // see if we can extend this line more
-                    position++; // move to the right one square
-                    if (!BitArray_readBit(connected, position)) // are the position and the one next to it connected?
-                        offset++; // extend the endpoint of the line
-                    else
-                        break; // there is a wall, the line needs to end
-                }
-                mazePath.lineTo(((x + (offset + 1.5)) * gridSpacing), ((y + 1.5) * gridSpacing));
-                x += offset; // if we were able to extend the line, adjust the index variable
-            }
-        }
-    }
-
-    QPen hallPen(Qt::black);
-    hallPen.setWidth(wallThickness);
-    if (roundCaps) {
-        hallPen.setCapStyle(Qt::RoundCap);
-        hallPen.setJoinStyle(Qt::RoundJoin);
-    } else {
-        hallPen.setCapStyle(Qt::SquareCap);
-        hallPen.setJoinStyle((Qt::MiterJoin));
-    }
-
-    painter->setPen(hallPen);
-    painter->drawPath(mazePath);
+    renderer().paintMazeWalls(painter, rect);
 }
 
 void MazeWidget::paintDebug(QPainter *painter, const QRect &rect)
@@ -403,7 +308,7 @@ void MazeWidget::paintDebug(QPainter *painter, const QRect &rect)
     // Draw a circle highlighting a position set with the debug menu
     for (int x = startX; x < endX; ++x) {
         for (int y = startY; y < endY; ++y) {
-            uint32_t position = y * mazeWidth + x; // convert (x, y) coordinates into a scalar position
+            MazeIndex position = (MazeIndex)y * mazeWidth + x; // convert (x, y) coordinates into a scalar position
             if (position == highlight)
                 debugPath.addEllipse(QPoint( ((x + 1) * gridSpacing), ((y + 1) * gridSpacing) ), gridSpacing / 4, gridSpacing / 4);
         }
@@ -419,85 +324,10 @@ void MazeWidget::paintDebug(QPainter *painter, const QRect &rect)
 
 void MazeWidget::paintSolution(QPainter *painter, const QRect &rect)
 {
-    if (creatingMaze) // make safe for something external to call
+    if (creatingMaze || !myMaze) // make safe for something external to call
         return;
 
-    QPainterPath solutionPath;
-
-    // Convert from view coordinates into maze coordinates
-    int startX = ((rect.left()) / gridSpacing) - 1 - 1;
-    if (startX < 0)
-        startX = 0;
-
-    int startY = ((rect.top()) / gridSpacing) - 1 - 1;
-    if (startY < 0)
-        startY = 0;
-
-    int endX = (((rect.right())) / gridSpacing) + 1;
-    if (endX > mazeWidth)
-        endX = mazeWidth;
-
-    int endY = (((rect.bottom())) / gridSpacing) + 1;
-    if (endY > mazeHeight)
-        endY = mazeHeight;
-
-    // Draw solution above entrance and exit
-    solutionPath.moveTo(((1) * gridSpacing), ((0) * gridSpacing));
-    solutionPath.lineTo(((1) * gridSpacing), ((1) * gridSpacing));
-    solutionPath.moveTo(((mazeWidth) * gridSpacing), ((mazeHeight) * gridSpacing));
-    solutionPath.lineTo(((mazeWidth) * gridSpacing), ((mazeHeight + 1) * gridSpacing));
-
-    // Draw horizontal paths in the solution
-    BitArrayRef connected = myMaze->solution[0];
-    for (int y = startY; y < endY; ++y) {
-        for (int x = startX; x < endX; ++x) {
-            uint32_t position = y * mazeWidth + x; // convert (x, y) coordinates into a scalar position
-            if (BitArray_readBit(connected, position)) { // are the position and the one next to it connected?
-                solutionPath.moveTo(((x + 1) * gridSpacing), ((y + 1) * gridSpacing));
-                int offset = 0;
-                while (x + offset + 1 < endX) { // see if we can extend this line more
-                    position++; // move to the right one square
-                    if (BitArray_readBit(connected, position)) // are the position and the one next to it connected?
-                        offset++; // extend the endpoint of the line
-                    else
-                        break; // there is a wall, the line needs to end
-                }
-                solutionPath.lineTo(((x + (offset + 1) + 1) * gridSpacing), ((y + 1) * gridSpacing));
-                x += offset; // if we were able to extend the line, adjust the index variable
-            }
-        }
-    }
-
-    // Draw vertical paths in the solution
-    connected = myMaze->solution[1];
-    for (int x = startX; x < endX; ++x) {
-        for (int y = startY; y < endY; ++y) {
-            uint32_t position = y * mazeWidth + x;
-            if (BitArray_readBit(connected, position)) { // are the position and the one next to it connected?
-                solutionPath.moveTo(((x + 1) * gridSpacing), ((y + 1) * gridSpacing));
-                int offset = 0;
-                while (y + offset + 1 < endY) { // see if we can extend this line more
-                    position += mazeWidth; // move down one square
-                    if (BitArray_readBit(connected, position)) // are the position and the one next to it connected?
-                        offset++; // extend the endpoint of the line
-                    else
-                        break; // there is a wall, the line needs to end
-                }
-                solutionPath.lineTo(((x + 1) * gridSpacing), ((y + (offset + 1) + 1) * gridSpacing));
-                y += offset; // if we were able to extend the line, adjust the index variable
-            }
-        }
-    }
-
-    QPen solutionPen(Qt::red);
-    solutionPen.setWidth(solutionThickness);
-    if (roundCaps)
-        solutionPen.setCapStyle(Qt::RoundCap);
-    else
-        solutionPen.setCapStyle(Qt::SquareCap);
-
-    painter->setPen(solutionPen);
-    painter->drawPath(solutionPath);
+    renderer().paintSolution(painter, rect);
 }
 
 void MazeWidget::printMaze()
@@ -519,7 +349,7 @@ void MazeWidget::printMaze()
 
         QRect rect(0, 0, ((mazeWidth + 1) * gridSpacing), ((mazeHeight + 1) * gridSpacing));
 
-        if (creatingMaze) {
+        if (creatingMaze || !myMaze) {
             QBrush brush(Qt::white);
             painter.setPen(Qt::NoPen);
             painter.setBrush(brush);
@@ -540,51 +370,48 @@ void MazeWidget::printMaze()
 
 void MazeWidget::exportImage()
 {
-    QString fileName= QFileDialog::getSaveFileName(this, tr("Export Image..."), QCoreApplication::applicationDirPath(), "BMP Files (*.bmp)" );
-    if (!fileName.isNull())
-    {
-        QFileInfo fileInfo(fileName);
-        if (fileInfo.suffix().isEmpty())
-            fileName.append(".bmp");
+    if (creatingMaze || !myMaze)
+        return;
 
-        QImage image(((mazeWidth + 1) * gridSpacing) * scaling, ((mazeHeight + 1) * gridSpacing) * scaling, QImage::Format_ARGB32_Premultiplied);
-        QPainter painter;
-        if (!painter.begin(&image)) {
-            QMessageBox::warning(this, "Error Exporting Image", "There was an error exporting the image; the maze is most likely too large.\n\nYou may configure its rendered size using the View > Maze Styles menu, or create a new maze with smaller dimensions.");
-            return;
-        }
+    QString pngFilter = "PNG Files (*.png)";
+    QString selectedFilter;
+    QString fileName= QFileDialog::getSaveFileName(this, tr("Export Image..."), QCoreApplication::applicationDirPath(), "BMP Files (*.bmp);;" + pngFilter, &selectedFilter);
+    if (fileName.isNull())
+        return;
 
-        painter.scale(scaling, scaling);
-        if (antialiased)
-            painter.setRenderHint(QPainter::Antialiasing);
+    QFileInfo fileInfo(fileName);
+    if (fileInfo.suffix().isEmpty())
+        fileName.append((selectedFilter == pngFilter) ? ".png" : ".bmp");
 
-        QRect rect(0, 0, ((mazeWidth + 1) * gridSpacing), ((mazeHeight + 1) * gridSpacing));
+    // Drawn in bands on the worker thread, and BMP files are streamed to the file, so the image may be far larger than
+    // memory
+    savingMaze = true;
 
-        if (creatingMaze) {
-            QBrush brush(Qt::gray);
-            painter.setPen(Qt::NoPen);
-            painter.setBrush(brush);
-            painter.drawRect(scaleRect(rect));
-        } else {
-            paintPathBackground(&painter, scaleRect(rect));
-            if (showMaze) {
-                if (inverse)
-                    paintMazePaths(&painter, scaleRect(rect));
-                else
-                    paintMazeWalls(&painter, scaleRect(rect));
-            }
-            if (showSolution)
-                paintSolution(&painter, scaleRect(rect));
-        }
+    ExportImageWorker *worker = new ExportImageWorker(renderer(), fileName, scaling, showMaze, showSolution);
+    worker->moveToThread(&workerThread);
+    connect(worker, &ExportImageWorker::exportImageWorker_error, this, &MazeWidget::exportImageWorker_error);
+    connect(worker, &ExportImageWorker::exportImageWorker_finished, this, &MazeWidget::exportImageWorker_finished);
+    connect(worker, &ExportImageWorker::exportImageWorker_finished, worker, &ExportImageWorker::deleteLater);
+    connect(worker, &ExportImageWorker::exportImageWorker_error, worker, &ExportImageWorker::deleteLater);
 
-        painter.end();
-        image.save(fileName);
-    }
+    // For progress indicators
+    connect(worker, &ExportImageWorker::exportImageWorker_exportingImage, this, &MazeWidget::exportImageWorker_exportingImage);
+
+    connect(this, &MazeWidget::exportImageWorker_start, worker, &ExportImageWorker::process);
+    emit exportImageWorker_start();
 }
 
 void MazeWidget::saveMazeAs()
 {
-    QString fileName = QFileDialog::getSaveFileName(this, tr("Save Maze..."), QString(), "Maze Files (*.maze)" );
+    if (creatingMaze || !myMaze)
+        return;
+
+    // Seed-only files are tiny, but the maze has to be generated again each time one is opened
+    QString compressedFilter = "Compressed Maze Files (*.maze)";
+    QString tiledFilter = "Tiled Maze Files (*.maze)";
+    QString seedOnlyFilter = "Seed-only Maze Files (*.maze)";
+    QString selectedFilter;
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Save Maze..."), QString(), "Maze Files (*.maze);;" + compressedFilter + ";;" + tiledFilter + ";;" + seedOnlyFilter, &selectedFilter);
 
     if (fileName.isNull())
         return;
@@ -595,7 +422,9 @@ void MazeWidget::saveMazeAs()
 
     savingMaze = true;
 
-    SaveMazeWorker *worker = new SaveMazeWorker(myMaze, fileName);
+    SaveMazeWorker::Format format = (selectedFilter == seedOnlyFilter) ? SaveMazeWorker::SeedOnly : (selectedFilter == compressedFilter) ? SaveMazeWorker::Compressed :
+                                    (selectedFilter == tiledFilter) ? SaveMazeWorker::Tiled : SaveMazeWorker::Bitmaps;
+    SaveMazeWorker *worker = new SaveMazeWorker(myMaze, fileName, format);
     worker->moveToThread(&workerThread);
     connect(worker, &SaveMazeWorker::saveMazeWorker_error, this, &MazeWidget::saveMazeWorker_error);
     connect(worker, &SaveMazeWorker::saveMazeWorker_finished, this, &MazeWidget::saveMazeWorker_finished);
@@ -618,31 +447,67 @@ void MazeWidget::paintEvent(QPaintEvent *event)
     if (antialiased)
         painter.setRenderHint(QPainter::Antialiasing);
 
-    if (creatingMaze) {
+    if (creatingMaze || !myMaze) {
         QBrush brush(Qt::gray);
         painter.setPen(Qt::NoPen);
         painter.setBrush(brush);
         painter.drawRect(scaleRect(event->rect()));
-    } else {
-        if (showMaze) {
-            if (inverse)
-                for(QRegion::const_iterator i = event->region().begin(); i != event->region().end(); i++)
-                    paintMazePaths(&painter, scaleRect(*i));
-            else
-                for(QRegion::const_iterator i = event->region().begin(); i != event->region().end(); i++)
-                    paintMazeWalls(&painter, scaleRect(*i));
+    } else if (pyramid && gridSpacing * scaling < 1) {
+        // Cells smaller than a pixel are drawn from the overview pyramid, instead of every wall in view
+        MazeRenderer mazeRenderer = renderer();
+        for(QRegion::const_iterator i = event->region().begin(); i != event->region().end(); i++) {
+            pyramid->paint(&painter, *i, mazeRenderer, scaling, showMaze, showSolution);
+            if (debug)
+                paintDebug(&painter, scaleRect(*i));
         }
+    } else {
+        // Blit the tiles that have been drawn already, and only draw the parts of the region that haven't been
+        MazeRenderer mazeRenderer = renderer();
+        if (showMaze)
+            paintLayer(&painter, event->region(), MazeTileCache::MazeLayer, mazeRenderer);
         if (showSolution)
-            for(QRegion::const_iterator i = event->region().begin(); i != event->region().end(); i++)
-                paintSolution(&painter, scaleRect(*i));
+            paintLayer(&painter, event->region(), MazeTileCache::SolutionLayer, mazeRenderer);
         if (debug)
             for(QRegion::const_iterator i = event->region().begin(); i != event->region().end(); i++)
                 paintDebug(&painter, scaleRect(*i));
+
+        // Draw what's in view (and around it) in the background, ready for the next time it needs painting
+        tileCache.prefetch(visibleRegion().boundingRect(), (showMaze ? MazeTileCache::MazeLayer : 0) | (showSolution ? MazeTileCache::SolutionLayer : 0), mazeRenderer, scaling);
     }
 
     painter.end();
 }
 
+void MazeWidget::paintLayer(QPainter *painter, const QRegion &region, MazeTileCache::Layer layer, const MazeRenderer &mazeRenderer)
+{
+    QRegion missing;
+    painter->save();
+    painter->resetTransform(); // tiles are drawn scaled already
+    for(QRegion::const_iterator i = region.begin(); i != region.end(); i++)
+        missing += tileCache.paint(painter, *i, layer, mazeRenderer, scaling);
+    painter->restore();
+
+    for(QRegion::const_iterator i = missing.begin(); i != missing.end(); i++) {
+        // Small grid spacings are drawn straight into an image's pixels, which is far faster than building paths
+        if (mazeRenderer.canRasterize(scaling)) {
+            QImage image(i->size(), QImage::Format_ARGB32_Premultiplied);
+            image.fill(Qt::transparent);
+            if (layer == MazeTileCache::MazeLayer)
+                mazeRenderer.rasterizeMaze(&image, i->topLeft(), scaling);
+            else
+                mazeRenderer.rasterizeSolution(&image, i->topLeft(), scaling);
+            painter->save();
+            painter->resetTransform();
+            painter->drawImage(i->topLeft(), image);
+            painter->restore();
+        } else if (layer == MazeTileCache::MazeLayer) {
+            mazeRenderer.paintMaze(painter, scaleRect(*i));
+        } else {
+            mazeRenderer.paintSolution(painter, scaleRect(*i));
+        }
+    }
+}
+
 bool MazeWidget::getRoundCaps() const
 {
     return roundCaps;
@@ -651,6 +516,7 @@ bool MazeWidget::getRoundCaps() const
 void MazeWidget::setRoundCaps(bool value)
 {
     roundCaps = value;
+    tileCache.invalidate(MazeTileCache::AllLayers);
     update();
 }
 
@@ -679,15 +545,29 @@ void MazeWidget::generateMazeWorker_finished(void *maze)
     creatingMaze = false;
     solutionLength = ((MazeRef)maze)->solutionLength;
     myMaze = (MazeRef)maze;
+    buildPyramid();
     resetWidgetSize();
     update();
     emit on_mazeCreated();
 }
 
-void MazeWidget::generateMazeWorker_error(QString err)
+void MazeWidget::generateMazeWorker_error(void *maze, QString err)
 {
-    (void)err;
-    //qDebug() << "generateMazeWorker_error: " << err;
+    // Avoid displaying the busy cursor when displaying the error message
+    emit on_generateMazeError(err);
+
+    // Maze_generate() and Maze_solve() leave the maze as it was when they fail, so it is still safe to display, but
+    // there is no maze at all if Maze_create() failed
+    creatingMaze = false;
+    solutionLength = maze ? ((MazeRef)maze)->solutionLength : 0;
+    myMaze = (MazeRef)maze;
+    buildPyramid();
+    resetWidgetSize();
+    update();
+
+    // Display the error message, and re-enable the menus
+    QMessageBox::warning(this, "Error Generating Maze", err);
+    emit on_generateMazePostError();
 }
 
 void MazeWidget::deleteMazeWorker_finished(void *maze)
@@ -725,6 +605,7 @@ void MazeWidget::openMazeWorker_finished(void *maze)
     creatingMaze = false;
     solutionLength = ((MazeRef)maze)->solutionLength;
     myMaze = (MazeRef)maze;
+    buildPyramid();
     resetWidgetSize();
     update();
     emit on_mazeCreated();
@@ -737,8 +618,9 @@ void MazeWidget::openMazeWorker_error(void *maze, QString err)
 
     // Restore the old maze, since the new one couldn't be loaded
     creatingMaze = false;
-    solutionLength = ((MazeRef)maze)->solutionLength;
+    solutionLength = maze ? ((MazeRef)maze)->solutionLength : 0;
     myMaze = (MazeRef)maze;
+    buildPyramid();
     resetWidgetSize();
     update();
 
@@ -765,6 +647,24 @@ void MazeWidget::saveMazeWorker_error(QString err)
     QMessageBox::warning(this, "Error Saving Maze", err);
 }
 
+void MazeWidget::exportImageWorker_exportingImage()
+{
+    emit on_exportingImage();
+}
+
+void MazeWidget::exportImageWorker_finished()
+{
+    savingMaze = false;
+    emit on_imageExported();
+}
+
+void MazeWidget::exportImageWorker_error(QString err)
+{
+    savingMaze = false;
+    emit on_exportImageError(err);
+    QMessageBox::warning(this, "Error Exporting Image", err);
+}
+
 bool MazeWidget::getShowMaze() const
 {
     return showMaze;
@@ -795,6 +695,7 @@ int MazeWidget::getSolutionThickness() const
 void MazeWidget::setSolutionThickness(int value)
 {
     solutionThickness = value;
+    tileCache.invalidate(MazeTileCache::SolutionLayer);
     update();
 }
 
@@ -803,6 +704,7 @@ void MazeWidget::resetDefaultSpacing()
     gridSpacing = DEFAULT_GRID_SPACING;
     wallThickness = DEFAULT_WALL_THICKNESS;
     solutionThickness = DEFAULT_SOLUTION_THICKNESS;
+    tileCache.invalidate(MazeTileCache::AllLayers);
     resetWidgetSize();
     update();
 }
@@ -815,6 +717,7 @@ int MazeWidget::getWallThickness() const
 void MazeWidget::setWallThickness(int value)
 {
     wallThickness = value;
+    tileCache.invalidate(MazeTileCache::MazeLayer);
     update();
 }
 
@@ -826,6 +729,7 @@ int MazeWidget::getGridSpacing() const
 void MazeWidget::setGridSpacing(int value)
 {
     gridSpacing = value;
+    tileCache.invalidate(MazeTileCache::AllLayers);
     resetWidgetSize();
     update();
 }
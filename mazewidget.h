@@ -13,6 +13,9 @@
 #include <QThread>
 #include <QRect>
 #include "Maze.h"
+#include "mazerenderer.h"
+#include "mazetilecache.h"
+#include "mazepyramid.h"
 
 #define DEFAULT_GRID_SPACING 24
 #define DEFAULT_WALL_THICKNESS 8
@@ -75,7 +78,7 @@ public:
     bool getInverse() const;
     void setInverse(bool value);
 
-    uint32_t getSolutionLength() const;
+    MazeIndex getSolutionLength() const;
 
     bool getSavingMaze() const;
 
@@ -91,12 +94,16 @@ signals:
     void deleteMazeWorker_start();
     void openMazeWorker_start();
     void saveMazeWorker_start();
+    void buildPyramidWorker_start();
+    void exportImageWorker_start();
 
     void on_deletingOldMaze();
     void on_allocatingMemory();
     void on_generatingMaze();
     void on_solvingMaze();
     void on_mazeCreated();
+    void on_generateMazeError(QString err);
+    void on_generateMazePostError();
     void on_openMazePostError();
 
     void on_openMaze();
@@ -106,13 +113,17 @@ signals:
     void on_saveMazeError(QString err);
     void on_mazeSaved();
 
+    void on_exportingImage();
+    void on_exportImageError(QString err);
+    void on_imageExported();
+
 public slots:
     void generateMazeWorker_deletingOldMaze();
     void generateMazeWorker_allocatingMemory();
     void generateMazeWorker_generatingMaze();
     void generateMazeWorker_solvingMaze();
     void generateMazeWorker_finished(void *maze);
-    void generateMazeWorker_error(QString err);
+    void generateMazeWorker_error(void *maze, QString err);
 
     void deleteMazeWorker_finished(void *maze);
     void deleteMazeWorker_error(QString err);
@@ -127,20 +138,32 @@ public slots:
     void saveMazeWorker_finished();
     void saveMazeWorker_error(QString err);
 
+    void exportImageWorker_exportingImage();
+    void exportImageWorker_finished();
+    void exportImageWorker_error(QString err);
+
+    void buildPyramidWorker_finished(void *maze, void *pyramid);
+
 protected:
     void paintEvent(QPaintEvent *event) override;
 
 private:
     void resetWidgetSize();
+    MazeRenderer renderer() const;
+    void paintLayer(QPainter *painter, const QRegion &region, MazeTileCache::Layer layer, const MazeRenderer &mazeRenderer);
+    void buildPyramid();
+    void releasePyramid();
 
     QThread workerThread;
+    MazeTileCache tileCache;
+    MazePyramid *pyramid = 0; // for drawing the maze once its cells are smaller than a pixel
     bool creatingMaze = false;
     bool savingMaze = false;
 
     MazeRef myMaze = 0;
     int mazeWidth = 25;
     int mazeHeight = 25;
-    uint32_t solutionLength = 0; // trivia returned from the maze solver
+    MazeIndex solutionLength = 0; // trivia returned from the maze solver
 
     int gridSpacing = DEFAULT_GRID_SPACING;
     int wallThickness = DEFAULT_WALL_THICKNESS;
@@ -20,6 +20,11 @@ NewDialog::NewDialog(QWidget *parent, int width, int height) :
     height(height)
 {
     ui->setupUi(this);
+#ifdef MAZE_64BIT
+    // 64-bit builds aren't limited to 2^31 cells
+    ui->spinBoxWidth->setMaximum(1 << 20);
+    ui->spinBoxHeight->setMaximum(1 << 20);
+#endif
     ui->spinBoxWidth->setValue(width);
     ui->spinBoxHeight->setValue(height);
     ui->spinBoxWidth->setFocus();
@@ -48,16 +53,16 @@ void NewDialog::updateMemoryDisplay()
     uint64_t memory = sizeof(Maze);
     uint32_t dims[2] = { width, height };
     uint32_t length = 2;
-    uint32_t totalPositions = 1;
-    uint32_t totalWalls = 0;
+    uint64_t totalPositions = 1;
+    uint64_t totalWalls = 0;
 
-    memory += sizeof(uint32_t) * length;
+    memory += (sizeof(uint32_t) + sizeof(MazeIndex)) * length; // dims and placeValues
 
     for (uint32_t i = 0; i < length; ++i)
         totalPositions *= dims[i];
 
     for (uint32_t i = 0; i < length; ++i) {
-        uint32_t subTotal = 1;
+        uint64_t subTotal = 1;
         for (uint32_t j = 0; j < length; ++j)
             if (j != i)
                 subTotal *= dims[j];
@@ -68,9 +73,10 @@ void NewDialog::updateMemoryDisplay()
     memory += sizeof(uint8_t) * totalPositions;
     memory += sizeof(BitArrayRef) * length * 2;
 
-    memory += sizeof(int32_t) * totalPositions; // DisjSets_create
+    memory += sizeof(DisjSetsIndex) * totalPositions; // DisjSets_create
+    memory += sizeof(uint64_t) * totalPositions; // Maze_generate (maBoruvka)
     memory += sizeof(BitArray) * length * 2;
-    memory += (totalPositions / 8 + ((totalPositions % 8) ? 1 : 0)) * length * 2;
+    memory += sizeof(uint64_t) * (totalPositions / 64 + ((totalPositions % 64) ? 1 : 0)) * length * 2;
 
     ui->labelMemory->setText(sizeHuman(memory));
 }
@@ -12,8 +12,8 @@
 #include <QObject>
 #include <QString>
 #include <QFile>
+#include <QThread>
 #include <QDebug>
-#include <QtEndian>
 
 #include "Maze.h"
 
@@ -35,124 +35,38 @@ signals:
 
 public slots:
     void process() {
-        QFile file(fileName);
-        if (!file.open(QIODevice::ReadOnly)) {
-            emit openMazeWorker_error((void*)myMaze, QString("The file '%1' could not be opened.").arg(fileName));
+        // Set up like GenerateMazeWorker does, so version 1 files are decoded (and later mazes generated) on every core
+#ifdef Q_OS_WASM
+        int idealThreads = 2;
+#else
+        int idealThreads = QThread::idealThreadCount();
+#endif
+        emit openMazeWorker_allocatingMemory();
+        // Version 2 and tiled files are mapped rather than read, so this takes the same time whatever the maze's size
+        MazeRef newMaze = Maze_loadLazily(QFile::encodeName(fileName).constData(), (idealThreads > 0) ? idealThreads : 1);
+        if (!newMaze) {
+            emit openMazeWorker_error((void*)myMaze, QString("The file '%1' could not be opened as a maze.").arg(fileName));
             return;
         }
-        uchar *memory = file.map(0, file.size());
-        if (!memory) {
-            emit openMazeWorker_error((void*)myMaze, QString("The file '%1' could not be mapped to memory.").arg(fileName));
-            return;
-        }
-        if (file.size() < (qint64)sizeof(uint32_t)) {
-            file.unmap(memory);
-            emit openMazeWorker_error((void*)myMaze, QString("The file '%1' is not valid.").arg(fileName));
-            return;
-        }
-
-        uint32_t dims_length = qFromLittleEndian<uint32_t>(memory);
-
-        if (dims_length != 2) {
-            file.unmap(memory);
-            emit openMazeWorker_error((void*)myMaze, QString("Cannot load a maze with %2 dimensions.").arg(dims_length));
+        if (newMaze->dims_length != 2) {
+            emit openMazeWorker_error((void*)myMaze, QString("Cannot load a maze with %1 dimensions.").arg(newMaze->dims_length));
+            Maze_delete(newMaze);
             return;
         }
+        Maze_setAlgorithm(newMaze, maBoruvka);
+        Maze_setSolver(newMaze, msWorklist);
 
-        if (file.size() < (qint64)sizeof(uint32_t) * (dims_length + 1)) {
-            file.unmap(memory);
-            emit openMazeWorker_error((void*)myMaze, QString("The file '%1' is not valid.").arg(fileName));
-            return;
-        }
+        // The old maze is only deleted once the new one has loaded, so it can still be shown if the new one can't be
+        emit openMazeWorker_deletingOldMaze();
+        Maze_delete(myMaze);
+        myMaze = newMaze;
 
-        uint32_t *dims = new uint32_t[dims_length];
-        for (uint32_t i = 0; i < dims_length; ++i)
-            dims[i] = qFromLittleEndian<uint32_t>(memory + sizeof(uint32_t) * (i + 1));
-
-        uint32_t totalPositions = 1;
-        for (uint32_t i = 0; i < dims_length; ++i)
-            totalPositions *= dims[i];
-
-        uint32_t totalWalls = 0;
-        for (uint32_t i = 0; i < dims_length; ++i) {
-            uint32_t subTotal = 1;
-            for (uint32_t j = 0; j < dims_length; ++j)
-                if (j != i)
-                    subTotal *= dims[j];
-            totalWalls += subTotal * (dims[i] - 1);
-        }
-
-        BitArray baMaze, baSolution;
-        baMaze.numBits = baSolution.numBits = totalWalls;
-        baMaze.data_length = baSolution.data_length = totalWalls / 8 + ((totalWalls % 8) ? 1 : 0);
-
-        if (file.size() < (qint64)sizeof(uint32_t) * (dims_length + 2) + baMaze.data_length + baSolution.data_length) {
-            delete [] dims;
-            file.unmap(memory);
-            emit openMazeWorker_error((void*)myMaze, QString("The file '%1' is not valid.").arg(fileName));
-            return;
-        }
-
-        baMaze.data = memory + sizeof(uint32_t) * (dims_length + 1); // The + 1 is to skip the dims_length header
-
-        uint32_t solutionLength = qFromLittleEndian<uint32_t>(baMaze.data + baMaze.data_length);
-        baSolution.data = baMaze.data + baMaze.data_length + sizeof(uint32_t);
-
-        if ((myMaze == 0) || (myMaze->dims[0] != dims[0]) || (myMaze->dims[1] != dims[1])) {
-            emit openMazeWorker_deletingOldMaze();
-            Maze_delete(myMaze);
-            emit openMazeWorker_allocatingMemory();
-            myMaze = Maze_create(dims, dims_length, (MazeCreateFlags)(mcfOutputMaze | mcfOutputSolution /*| mcfMultipleSolves*/));
-        }
-
-        emit openMazeWorker_loadingMaze((int)dims[0], (int)dims[1]);
-
-        for (uint32_t i = 0; i < myMaze->dims_length; ++i) {
-            BitArray_reset(myMaze->halls[i]);
-            BitArray_reset(myMaze->solution[i]);
-        }
-
-        // Maze
-        uint32_t lotteryIndex = 0;
-        for (uint32_t position = 0; position < totalPositions; ++position) {
-            uint32_t placeValue = 1;
-            for (uint32_t i = 0; i < dims_length; ++i) {
-                uint32_t valueForThisDim = (position / placeValue) % dims[i];
-                if (valueForThisDim < dims[i] - 1) {
-                    if (BitArray_readBit(&baMaze, lotteryIndex)) {
-                        BitArray_setBit(myMaze->halls[i], position);
-    //                    qDebug() << "Wall: (" << position << "," << (position + placeValue) << ")";
-    //                    qDebug() << "Corresponds to Wall #" << lotteryIndex;
-                    }
-                    lotteryIndex++;
-                }
-                placeValue *= dims[i];
-            }
-        }
-
-        // Solution
-        lotteryIndex = 0;
-        for (uint32_t position = 0; position < totalPositions; ++position) {
-            uint32_t placeValue = 1;
-            for (uint32_t i = 0; i < dims_length; ++i) {
-                uint32_t valueForThisDim = (position / placeValue) % dims[i];
-                if (valueForThisDim < dims[i] - 1) {
-                    if (BitArray_readBit(&baSolution, lotteryIndex)) {
-                        BitArray_setBit(myMaze->solution[i], position);
-    //                    qDebug() << "Wall: (" << position << "," << (position + placeValue) << ")";
-    //                    qDebug() << "Corresponds to Wall #" << lotteryIndex;
-                    }
-                    lotteryIndex++;
-                }
-                placeValue *= dims[i];
-            }
-        }
-
-        delete [] dims;
-        file.unmap(memory);
-
-        myMaze->solutionLength = solutionLength;
+        emit openMazeWorker_loadingMaze((int)myMaze->dims[0], (int)myMaze->dims[1]);
         emit openMazeWorker_finished((void*)myMaze);
+
+        // The widget decodes the tiles in view as it paints them, and the rest are decoded here in the meantime, before
+        // anything else queued on this thread can use the maze
+        Maze_loadAll(myMaze);
     }
 
 private:
@@ -13,7 +13,6 @@
 #include <QString>
 #include <QFile>
 #include <QDebug>
-#include <QtEndian>
 
 #include "Maze.h"
 
@@ -21,7 +20,14 @@ class SaveMazeWorker : public QObject
 {
     Q_OBJECT
 public:
-    explicit SaveMazeWorker(MazeRef myMaze, QString fileName) : myMaze(myMaze), fileName(fileName)
+    enum Format {
+        Bitmaps, // opens the fastest
+        Compressed, // about half the size
+        Tiled, // compressed, but opens straight away, decoding the part in view first
+        SeedOnly, // a few dozen bytes, but the maze is generated again each time it's opened
+    };
+
+    explicit SaveMazeWorker(MazeRef myMaze, QString fileName, Format format) : myMaze(myMaze), fileName(fileName), format(format)
     {
 
     }
@@ -35,77 +41,17 @@ public slots:
     void process() {
         emit saveMazeWorker_savingMaze();
 
-        QFile file(fileName);
-        if (!file.open(QIODevice::ReadWrite)) {
-            emit saveMazeWorker_error(QString("The file '%1' could not be opened.").arg(fileName));
+        if (format == SeedOnly && !myMaze->seedUsed) {
+            emit saveMazeWorker_error(QString("This maze was opened from a file, so it can only be saved with all of its walls."));
             return;
         }
-        BitArray baMaze, baSolution;
-        baMaze.numBits = baSolution.numBits = myMaze->totalWalls;
-        baMaze.data_length = baSolution.data_length = myMaze->totalWalls / 8 + ((myMaze->totalWalls % 8) ? 1 : 0);
-
-        qint64 fileSize = sizeof(uint32_t) * (myMaze->dims_length + 2) + baMaze.data_length + baSolution.data_length;
-        if (!file.resize(fileSize)) {
-            emit saveMazeWorker_error(QString("The file '%1' could not be resized.").arg(fileName));
-            return;
-        }
-        uchar *memory = file.map(0, fileSize);
-        if (!memory) {
-            emit saveMazeWorker_error(QString("The file '%1' could not be mapped to memory.").arg(fileName));
+        QByteArray name = QFile::encodeName(fileName);
+        bool saved = (format == SeedOnly) ? Maze_saveSeed(myMaze, name.constData()) : (format == Compressed) ? Maze_saveCompressed(myMaze, name.constData()) :
+                     (format == Tiled) ? Maze_saveTiled(myMaze, name.constData()) : Maze_save(myMaze, name.constData());
+        if (!saved) {
+            emit saveMazeWorker_error(QString("The file '%1' could not be written.").arg(fileName));
             return;
         }
-        uint32_t dims_length = myMaze->dims_length;
-        qToLittleEndian(dims_length, memory);
-        for (uint32_t i = 0; i < myMaze->dims_length; ++i) {
-            uint32_t dim = myMaze->dims[i];
-            qToLittleEndian(dim, memory + sizeof(uint32_t) * (i + 1));
-        }
-
-        baMaze.data = memory + sizeof(uint32_t) * (dims_length + 1);
-        BitArray_reset(&baMaze);
-
-        uint32_t solutionLength = myMaze->solutionLength;
-        qToLittleEndian(solutionLength, baMaze.data + baMaze.data_length);
-
-        baSolution.data = baMaze.data + baMaze.data_length + sizeof(uint32_t);
-        BitArray_reset(&baSolution);
-
-        // Maze
-        uint32_t lotteryIndex = 0;
-        for (uint32_t position = 0; position < myMaze->totalPositions; ++position) {
-            uint32_t placeValue = 1;
-            for (uint32_t i = 0; i < myMaze->dims_length; ++i) {
-                uint32_t valueForThisDim = (position / placeValue) % myMaze->dims[i];
-                if (valueForThisDim < myMaze->dims[i] - 1) {
-                    if (BitArray_readBit(myMaze->halls[i], position)) {
-                        BitArray_setBit(&baMaze, lotteryIndex);
-    //                        qDebug() << "Wall: (" << position << "," << (position + placeValue) << ")";
-    //                        qDebug() << "Corresponds to Wall #" << lotteryIndex;
-                    }
-                    lotteryIndex++;
-                }
-                placeValue *= myMaze->dims[i];
-            }
-        }
-
-        // Solution
-        lotteryIndex = 0;
-        for (uint32_t position = 0; position < myMaze->totalPositions; ++position) {
-            uint32_t placeValue = 1;
-            for (uint32_t i = 0; i < myMaze->dims_length; ++i) {
-                uint32_t valueForThisDim = (position / placeValue) % myMaze->dims[i];
-                if (valueForThisDim < myMaze->dims[i] - 1) {
-                    if (BitArray_readBit(myMaze->solution[i], position)) {
-                        BitArray_setBit(&baSolution, lotteryIndex);
-    //                        qDebug() << "Solution: (" << position << "," << (position + placeValue) << ")";
-    //                        qDebug() << "Corresponds to Solution #" << lotteryIndex;
-                    }
-                    lotteryIndex++;
-                }
-                placeValue *= myMaze->dims[i];
-            }
-        }
-        file.unmap(memory);
 
         emit saveMazeWorker_finished();
     }
@@ -113,6 +59,7 @@ public slots:
 private:
     MazeRef myMaze = 0;
     QString fileName;
+    Format format;
 };
 
 #endif // SAVEMAZEWORKER_H